@@ -42,10 +42,51 @@
 #include <filesystem>
 #include <random>
 #include <iomanip>
+#include <charconv>
 #include <sstream>
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
+#include <list>
 #include <cstdint>
+#include <limits>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <deque>
+#include <memory_resource>
+#include <type_traits>
+#include <variant>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/signalfd.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <signal.h>
+#endif
 
 class AppException:public std::runtime_error
 {
@@ -55,1273 +96,7853 @@ public:
 
 namespace fs=std::filesystem;
 
-class CodeSnippet
+struct Fnv1a // FNV-1a, to spread keys; pass a hash back in as the seed to go on with more data
 {
-private:
-    fs::path path;
+    static constexpr std::uint32_t BASIS32=2166136261u;
+    static constexpr std::uint64_t BASIS64=14695981039346656037ull;
 
-    std::vector<std::string> code;
-    std::vector<std::vector<int> > state;
+    static std::uint32_t hash32(const char* data,std::size_t size,std::uint32_t h=BASIS32)
+    {
+        for(std::size_t i=0;i<size;i++)
+        {
+            h ^= (unsigned char)data[i];
+            h *= 16777619u;
+        }
 
-    bool fuzzyAllowed=true;
+        return h;
+    }
 
-    static constexpr int MIN_LEN    =3;
-    static constexpr int UNGUESSED  =0;
-    static constexpr int FUZZY_MATCH=1;
-    static constexpr int EXACT_MATCH=2;
-    static constexpr int FUZZY_FAIL =1;
-    static constexpr int FUZZY_COUNT=2;
+    static std::uint32_t hash32(const std::string& data,std::uint32_t h=BASIS32)
+    {
+        return hash32(data.data(),data.size(),h);
+    }
 
-public:
-    CodeSnippet(){};
+    static std::uint64_t hash64(const char* data,std::size_t size,std::uint64_t h=BASIS64)
+    {
+        for(std::size_t i=0;i<size;i++)
+        {
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ull;
+        }
 
-    CodeSnippet(const fs::path& filePath,bool fuzzy=true):path(filePath),fuzzyAllowed(fuzzy)
+        return h;
+    }
+
+    static std::uint64_t hash64(const std::string& data,std::uint64_t h=BASIS64)
     {
-        loadFromFile();
+        return hash64(data.data(),data.size(),h);
     }
+};
 
-    void loadFromFile()
+class FileLock // an exclusive lock between processes, held while the object lives
+{
+private:
+#ifdef _WIN32
+    HANDLE file=INVALID_HANDLE_VALUE;
+#else
+    int fd=-1;
+#endif
+
+public:
+    FileLock(const fs::path& path)
     {
-        std::ifstream fin(path);
-        if(!fin)
+    #ifdef _WIN32
+        file=CreateFileW(path.wstring().c_str(),GENERIC_READ|GENERIC_WRITE,
+                         FILE_SHARE_READ|FILE_SHARE_WRITE,nullptr,OPEN_ALWAYS,FILE_ATTRIBUTE_NORMAL,nullptr);
+        if(file == INVALID_HANDLE_VALUE)
             throw AppException("Could not open file: "+path.string());
 
-        // read the file
-        std::string line;
-        while(std::getline(fin,line))
+        OVERLAPPED overlapped{};
+        if(!LockFileEx(file,LOCKFILE_EXCLUSIVE_LOCK,0,MAXDWORD,MAXDWORD,&overlapped))
         {
-            // replace '\t' to 4 space
-            const std::string tab4(4,' ');
-            std::size_t pos=0;
-            while((pos=line.find('\t',pos)) != std::string::npos)
-            {
-                line.replace(pos,1,tab4);
-                pos += tab4.size();
-            }
-
-            line.append(MIN_LEN-1,' '); // for all non-empty lines can be guessed
-
-            code.push_back(line);
-            state.push_back(std::vector<int>((int)line.size()));
+            CloseHandle(file);
+            throw AppException("Could not lock file: "+path.string());
         }
+    #else
+        fd=::open(path.c_str(),O_RDWR|O_CREAT,0644);
+        if(fd<0)
+            throw AppException("Could not open file: "+path.string());
 
-        fin.close();
+        if(flock(fd,LOCK_EX) != 0)
+        {
+            ::close(fd);
+            throw AppException("Could not lock file: "+path.string());
+        }
+    #endif
     }
 
-    int getMinLen()
+    FileLock(const FileLock&)=delete;
+    FileLock& operator=(const FileLock&)=delete;
+
+    ~FileLock()
     {
-        return MIN_LEN;
+    #ifdef _WIN32
+        OVERLAPPED overlapped{};
+        UnlockFileEx(file,0,MAXDWORD,MAXDWORD,&overlapped);
+        CloseHandle(file);
+    #else
+        flock(fd,LOCK_UN);
+        ::close(fd);
+    #endif
     }
+};
 
-    int getTotalNumber()
+class ThreadPool // work stealing: every worker has its own queue and takes from the others when it runs dry
+{
+private:
+    struct Queue
     {
-        // get the number of all visible characters
-        int total=0;
-        for(auto& line:code)
-        {
-            for(auto& c:line)
-            {
-                if(c != ' ')
-                    total++;
-            }
-        }
+        std::mutex mtx;
+        std::deque<std::function<void()> > tasks;
+    };
 
-        return total;
-    }
+    std::vector<std::unique_ptr<Queue> > queues; // one per worker
+    std::vector<std::thread> workers;
 
-    int getGuessedNumber()
+    std::mutex mtx;                  // for sleeping and waiting only
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+
+    std::atomic<long> queued{0};     // in some queue, not taken yet
+    std::atomic<long> pending{0};    // submitted, not finished yet
+    std::atomic<unsigned> nextQueue{0};
+    bool stopping=false;
+
+    // the pool and queue of the worker running on this thread
+    static inline thread_local ThreadPool* currentPool=nullptr;
+    static inline thread_local int currentQueue=-1;
+
+    // the own queue is used as a stack, the newest task is still in the cache
+    bool pop(int index,std::function<void()>& task)
     {
-        // get the number of all visible and guessed characters
-        int guessed=0;
-        for(int i=0;i<(int)code.size();i++)
-        {
-            auto& line=code[i];
-            for(int j=0;j<(int)line.size();j++)
-                if(line[j] != ' ' && state[i][j] == EXACT_MATCH)
-                    guessed++;
-        }
+        Queue& queue=*queues[index];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if(queue.tasks.empty())
+            return false;
 
-        return guessed;
+        task=std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queued--;
+
+        return true;
     }
 
-    void reveal()
+    // the others are robbed of their oldest task
+    bool steal(int index,std::function<void()>& task)
     {
-        std::vector<std::array<int,2> > posVec;
-        for(int i=0;i<(int)code.size();i++)
+        int n=(int)queues.size();
+        for(int i=1;i<n;i++)
         {
-            auto& line=code[i];
-            for(int j=0;j<(int)line.size();j++)
-                if(line[j] != ' ' && state[i][j] != EXACT_MATCH)
-                    posVec.push_back({i,j});
-        }
-
-        if(posVec.empty())
-            return;
+            Queue& queue=*queues[(index+i)%n];
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            if(queue.tasks.empty())
+                continue;
 
-        // use random number generator to get a random index
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(0,(int)posVec.size()-1);
+            task=std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            queued--;
 
-        auto pos=posVec[dist(gen)];
+            return true;
+        }
 
-        state[pos[0]][pos[1]]=EXACT_MATCH;
+        return false;
     }
 
-    std::array<int,2> guess(const std::string& guess)
+    void workerLoop(int index)
     {
-        int len=(int)guess.size();
-        if(len<MIN_LEN)
-            return {-1,-1}; // -1: unguessed
-        
-        std::array<int,2> result{};
-        if(!fuzzyAllowed)
-            result[1]=-1;   // -1: fuzzy match not allowed
+        currentPool=this;
+        currentQueue=index;
 
-        for(int i=0;i<(int)code.size();i++)
+        while(true)
         {
-            auto& line=code[i];
-            for(int j=0;j <= (int)line.size()-len;j++)
+            std::function<void()> task;
+            if(pop(index,task) || steal(index,task))
             {
-                if(line.substr(j,len) == guess)
-                {
-                    result[0]++;
+                task();
+                task=nullptr;
 
-                    // update the state
-                    for(int k=0;k<len;k++)
-                        state[i][j+k]=EXACT_MATCH;
-                    continue;
+                if(--pending == 0)
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    allDone.notify_all();
                 }
+                continue;
+            }
 
-                if(!fuzzyAllowed)
-                    continue;
-
-                int failmatch=0,count=0;
+            std::unique_lock<std::mutex> lock(mtx);
+            taskReady.wait(lock,[this]{return stopping || queued.load()>0;});
 
-                // get the failmatch count and the count of guessed characters(>= 2)
-                for(int k=0;k<len;k++)
-                {
-                    if(guess[k] != ' ')
-                        count++;
+            if(stopping && queued.load() == 0)
+                return; // stopping and nothing left to do
+        }
+    }
 
-                    if(line[j+k] != guess[k])
-                        failmatch++;
-                }
+public:
+    ThreadPool(unsigned threads=std::thread::hardware_concurrency())
+    {
+        if(threads == 0)
+            threads=1;
 
-                if(failmatch <= FUZZY_FAIL && count >= FUZZY_COUNT)
-                {
-                    result[1]++;
+        for(unsigned i=0;i<threads;i++)
+            queues.push_back(std::make_unique<Queue>());
 
-                    // update the state
-                    for(int k=0;k<len;k++)
-                        if(state[i][j+k] == UNGUESSED)
-                            state[i][j+k]=FUZZY_MATCH;
-                }
-            }
-        }
-        return result;
+        for(unsigned i=0;i<threads;i++)
+            workers.emplace_back([this,i]{workerLoop((int)i);});
     }
 
-    bool check()
+    ThreadPool(const ThreadPool&)=delete;
+    ThreadPool& operator=(const ThreadPool&)=delete;
+
+    ~ThreadPool()
     {
-        // check if all characters are guessed
-        bool ok=true;
-        for(int i=0;i<(int)code.size();i++)
         {
-            auto& line=code[i];
-            for(int j=0;j<(int)line.size();j++)
-                if(line[j] != ' ' && state[i][j] != EXACT_MATCH)
-                {
-                    ok=false;
-                    break;
-                }
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping=true;
         }
+        taskReady.notify_all();
 
-        return ok;
+        for(auto& worker:workers)
+            worker.join();
     }
 
-    std::vector<std::string> getMasked(const char& placeholder='@',const char& fuzzyPlaceholder='#')
+    int size()
     {
-        // get the masked code
-        std::vector<std::string> result;
-        for(int i=0;i<(int)code.size();i++)
+        return (int)workers.size();
+    }
+
+    // a worker queues on its own queue, other threads spread over all of them
+    void submit(std::function<void()> task)
+    {
+        int index=currentPool == this ?currentQueue:(int)(nextQueue++%queues.size());
+
+        pending++;
         {
-            auto line=code[i];
-            for(int j=0;j<(int)line.size();j++)
-            {
-                if(line[j] == ' ' || state[i][j] == EXACT_MATCH)
-                    continue;
-                if(state[i][j] == UNGUESSED)
-                    line[j]=placeholder;
-                if(state[i][j] == FUZZY_MATCH)
-                    line[j]=fuzzyPlaceholder;
-            }
-            result.push_back(line);
+            Queue& queue=*queues[index];
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            queue.tasks.push_back(std::move(task));
         }
+        queued++;
 
-        return result;
+        std::lock_guard<std::mutex> lock(mtx);
+        taskReady.notify_one();
+    }
+
+    // block until every submitted task has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        allDone.wait(lock,[this]{return pending.load() == 0;});
     }
 };
 
-class CodeRepo
+class Strand // runs its tasks one at a time and in order, each on whichever worker is free
 {
 private:
-    fs::path root;
-    std::vector<fs::path> cacheVec;
+    ThreadPool& pool;
 
-    void refresh()
+    std::mutex mtx;
+    std::deque<std::function<void()> > tasks;
+    bool scheduled=false;
+
+    // one task per turn, so a busy strand cannot keep a worker to itself
+    void runNext()
     {
-        cacheVec.clear();
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            task=std::move(tasks.front());
+            tasks.pop_front();
+        }
 
-        for(auto& e:fs::directory_iterator(root))
-            if(e.is_regular_file() && e.path().extension() == ".txt")
-                cacheVec.push_back(e.path());
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(tasks.empty())
+            {
+                scheduled=false;
+                return; // the task goes last, it may hold the owner of the strand
+            }
+        }
 
-        std::sort(cacheVec.begin(), cacheVec.end(),
-                  [](auto& a,auto& b){return a.filename()<b.filename();});
+        pool.submit([this]{runNext();});
     }
 
 public:
-    CodeRepo(){};
+    Strand(ThreadPool& workers):pool(workers){};
+
+    Strand(const Strand&)=delete;
+    Strand& operator=(const Strand&)=delete;
 
-    CodeRepo(const fs::path& dir):root(dir)
+    // the strand must live until its tasks have run, a task can keep its owner alive
+    void post(std::function<void()> task)
     {
-        if(!fs::exists(root))
-            fs::create_directories(root);
-        
-        refresh();
-    };
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.push_back(std::move(task));
+            if(scheduled)
+                return;
+            scheduled=true;
+        }
 
-    fs::path makePath(const std::string& pid)
+        pool.submit([this]{runNext();});
+    }
+};
+
+class MappedFile // a file mapped into memory, shared with every process that maps it
+{
+private:
+    char* data=nullptr;
+    std::size_t length=0;
+
+#ifdef _WIN32
+    HANDLE file=INVALID_HANDLE_VALUE;
+    HANDLE mapping=nullptr;
+#else
+    int fd=-1;
+#endif
+
+public:
+    MappedFile(){};
+
+    MappedFile(const fs::path& path,std::size_t minSize)
     {
-        return root/(pid+".txt");
+        open(path,minSize);
     }
 
-    std::vector<std::string> list()
+    MappedFile(const MappedFile&)=delete;
+    MappedFile& operator=(const MappedFile&)=delete;
+
+    ~MappedFile()
     {
-        std::vector<std::string> ids;
-        for(auto& id:cacheVec)
-            ids.push_back(id.stem().string());
-        
-        return ids;
+        close();
     }
 
-    void add(const std::string& pid,const std::vector<std::string> lines)
+    // create the file or grow it to at least minSize bytes, then map all of it
+    void open(const fs::path& path,std::size_t minSize)
     {
-        auto path=makePath(pid);
-        
-        std::ofstream fout(path);
-        if(!fout)
+        close();
+
+    #ifdef _WIN32
+        file=CreateFileW(path.wstring().c_str(),GENERIC_READ|GENERIC_WRITE,
+                         FILE_SHARE_READ|FILE_SHARE_WRITE,nullptr,OPEN_ALWAYS,FILE_ATTRIBUTE_NORMAL,nullptr);
+        if(file == INVALID_HANDLE_VALUE)
             throw AppException("Could not open file: "+path.string());
-        
-        for(auto& line:lines)
-            fout << line << '\n';
 
-        refresh();
-    }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file,&size);
+        length=std::max<std::size_t>((std::size_t)size.QuadPart,minSize);
 
-    bool remove(const std::string& pid)
-    {
-        auto path=makePath(pid);
+        mapping=CreateFileMappingW(file,nullptr,PAGE_READWRITE,(DWORD)((std::uint64_t)length>>32),(DWORD)length,nullptr);
+        if(!mapping)
+            throw AppException("Could not map file: "+path.string());
 
-        bool ok=fs::remove(path);
-        if(ok)
-            refresh();
-        
-        return ok;
+        data=(char*)MapViewOfFile(mapping,FILE_MAP_ALL_ACCESS,0,0,length);
+        if(!data)
+            throw AppException("Could not map file: "+path.string());
+    #else
+        fd=::open(path.c_str(),O_RDWR|O_CREAT,0644);
+        if(fd<0)
+            throw AppException("Could not open file: "+path.string());
+
+        struct stat st;
+        fstat(fd,&st);
+        length=std::max<std::size_t>((std::size_t)st.st_size,minSize);
+
+        if((std::size_t)st.st_size<length && ftruncate(fd,(off_t)length) != 0)
+            throw AppException("Could not resize file: "+path.string());
+
+        void* addr=mmap(nullptr,length,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        if(addr == MAP_FAILED)
+            throw AppException("Could not map file: "+path.string());
+
+        data=(char*)addr;
+    #endif
     }
 
-    std::string read(const std::string& pid)
+    void close()
     {
-        std::ifstream ifs(makePath(pid));
-        std::string data((std::istreambuf_iterator<char>(ifs)),
-                          std::istreambuf_iterator<char>());
-        
-        return data;
+    #ifdef _WIN32
+        if(data)
+            UnmapViewOfFile(data);
+        if(mapping)
+            CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+
+        mapping=nullptr;
+        file=INVALID_HANDLE_VALUE;
+    #else
+        if(data)
+            munmap(data,length);
+        if(fd >= 0)
+            ::close(fd);
+
+        fd=-1;
+    #endif
+
+        data=nullptr;
+        length=0;
     }
 
-    std::string random()
+    // write the dirty pages back to the file
+    void sync()
     {
-        if(cacheVec.empty()) 
-            return {};
-
-        // use random number generator to get a random index
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(0,(int)cacheVec.size()-1);
+        if(!data)
+            return;
 
-        auto path=cacheVec[dist(gen)];
+    #ifdef _WIN32
+        FlushViewOfFile(data,length);
+    #else
+        msync(data,length,MS_ASYNC);
+    #endif
+    }
 
-        return path.stem().string();
+    char* get()
+    {
+        return data;
     }
 
-    CodeSnippet loadSnippet(const std::string& pid, bool fuzzy=true)
+    std::size_t size()
     {
-        return CodeSnippet(makePath(pid),fuzzy);
+        return length;
     }
 };
 
-class StatisticsRepo
+// the first 64 bytes of every mapped table
+struct MappedHeader
 {
-private:
-    fs::path path;
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t capacity;       // entries the file has room for
+    std::uint32_t count;          // entries in use
+    std::uint32_t param;          // checked like the version, for example the size of a leaderboard
+    std::uint64_t appliedRecords; // history records folded into the table
+};
+
+template<typename Entry>
+class MappedTable // a header and an array of entries in a mapped file, which can always be rebuilt from the history
+{
+protected:
+    static constexpr int HEADER_SIZE=64;
+    static constexpr std::uint32_t ORDER_MARK=0x01020304;
 
-    int totalGames       {0};
-    int guessLimitedGames{0};
-    int timeAttackGames  {0};
-    int pointGames       {0};
-    int guessLimitedWins {0};
-    int timeAttackWins   {0};
-    double totalPoints   {0};
+    static_assert(std::is_trivially_copyable<Entry>::value,"mapped entries must be trivially copyable");
+    static_assert(sizeof(MappedHeader) <= HEADER_SIZE,"header too large");
 
-    std::vector<std::string> gameHistory;
+    fs::path path;
+    MappedFile file;
 
-public:
-    StatisticsRepo(){};
+    const char* magic;
+    std::uint32_t version;
+    std::uint32_t minCapacity;
+    std::uint32_t param;
 
-    StatisticsRepo(const fs::path& filePath):path(filePath)
+    MappedHeader* header()
     {
-        if(!fs::exists(path))
-            saveToFile();
+        return (MappedHeader*)file.get();
+    }
 
-        loadFromFile();
-    };
+    Entry* entries()
+    {
+        return (Entry*)(file.get()+HEADER_SIZE);
+    }
 
-    void loadFromFile()
+    static std::size_t fileSize(std::uint32_t capacity)
     {
-        std::ifstream fin(path,std::ios::binary);
-        if(!fin)
-            throw AppException("Could not open file: "+path.string());
+        return HEADER_SIZE+(std::size_t)capacity*sizeof(Entry);
+    }
 
-        fin.read((char*)&totalGames,sizeof(totalGames));
-        fin.read((char*)&guessLimitedGames,sizeof(guessLimitedGames));
-        fin.read((char*)&timeAttackGames,sizeof(timeAttackGames));
-        fin.read((char*)&pointGames,sizeof(pointGames));
-        fin.read((char*)&guessLimitedWins,sizeof(guessLimitedWins));
-        fin.read((char*)&timeAttackWins,sizeof(timeAttackWins));
-        fin.read((char*)&totalPoints,sizeof(totalPoints));
-
-        std::string line;
-        while(std::getline(fin,line))
-            gameHistory.push_back(line);
-        
-        fin.close();
+    void initialize(std::uint32_t capacity)
+    {
+        std::memset(file.get(),0,file.size());
+
+        MappedHeader* h=header();
+        std::memcpy(h -> magic,magic,4);
+        h -> version=version;
+        h -> byteOrder=ORDER_MARK;
+        h -> capacity=capacity;
+        h -> param=param;
     }
 
-    void saveToFile()
+    // map the file at a bigger size, the entries stay where they are
+    void resize(std::uint32_t capacity)
     {
-        std::ofstream fout(path,std::ios::binary);
-        if(!fout)
-            throw AppException("Could not open file: "+path.string());
-        
-        fout.write((char*)&totalGames,sizeof(totalGames));
-        fout.write((char*)&guessLimitedGames,sizeof(guessLimitedGames));
-        fout.write((char*)&timeAttackGames,sizeof(timeAttackGames));
-        fout.write((char*)&pointGames,sizeof(pointGames));
-        fout.write((char*)&guessLimitedWins,sizeof(guessLimitedWins));
-        fout.write((char*)&timeAttackWins,sizeof(timeAttackWins));
-        fout.write((char*)&totalPoints,sizeof(totalPoints));
-        
-        for(auto& line:gameHistory)
-            fout << line << '\n';
-        
-        fout.close();
+        file.close();
+        file.open(path,fileSize(capacity));
     }
 
-    template<typename T>
-    void addGame(const std::string& gameHistoryLine,const std::string& gameType,T state)
-    {
-        if(gameType == "guessLimited")
-        {
-            guessLimitedGames++;
-            guessLimitedWins += state;
-            // state is 1(win) or 0(lose)
-        }
-        else
-            if(gameType == "timeAttack")
-            {
-                timeAttackGames++;
-                timeAttackWins += state;
-                // state is 1(win) or 0(lose)
-            }
-            else
-                if(gameType == "point")
-                {
-                    pointGames++;
-                    totalPoints += state;
-                    // state is points
-                }
+public:
+    MappedTable(const char* tableMagic,std::uint32_t tableVersion,std::uint32_t tableMinCapacity,std::uint32_t tableParam=0)
+               :magic(tableMagic),version(tableVersion),minCapacity(tableMinCapacity),param(tableParam){};
 
-        totalGames++;
-        gameHistory.push_back(gameHistoryLine);
-    }
+    MappedTable(const MappedTable&)=delete;
+    MappedTable& operator=(const MappedTable&)=delete;
 
-    std::vector<std::string> getStatistics()
+    void open(const fs::path& filePath)
     {
-        std::vector<std::string> result;
+        path=filePath;
 
-        result.push_back("Total Games: "+std::to_string(totalGames));
-        result.push_back("Guess Limited Games: "+std::to_string(guessLimitedWins)
-                        +'/'+std::to_string(guessLimitedGames));
-        result.push_back("Time Attack Games: "+std::to_string(timeAttackWins)
-                        +'/'+std::to_string(timeAttackGames));
-        result.push_back("Point Games: "+std::to_string(pointGames));
-        result.push_back("Average Points: "+std::to_string(pointGames == 0 ?0:totalPoints/pointGames));
-        result.push_back("Total Points: "+std::to_string(totalPoints));
+        bool exists=fs::exists(path) && fs::file_size(path) >= fileSize(minCapacity);
+        file.open(path,fileSize(minCapacity));
 
-        result.push_back("\n==========Game History==========\n");
+        MappedHeader* h=header();
+        bool valid=exists && std::memcmp(h -> magic,magic,4) == 0 && h -> version == version &&
+                   h -> byteOrder == ORDER_MARK && h -> param == param && h -> count <= h -> capacity &&
+                   file.size() >= fileSize(h -> capacity);
 
-        // In time order, so the last game is at the top
-        for(int i=(int)gameHistory.size()-1;~i;i--)
-            result.push_back(gameHistory[i]);
-        
-        return result;
+        if(!valid)
+            initialize(minCapacity);
     }
-};
-
-struct GameHistoryFormatter
-{   
-    static constexpr int timeWidth    =26;
-    static constexpr int gameTypeWidth=18;
-    static constexpr int pidWidth     =7;
 
-    static std::string format(const std::string& time,const std::string& gameType,const std::string& pid,const std::string& gameInfo)
+    // in place, other processes keep the file mapped
+    void reset()
     {
-
-        std::ostringstream oss;
-        oss << std::left << std::setw(timeWidth) << time
-            << std::setw(gameTypeWidth) << gameType
-            << std::setw(pidWidth) << pid
-            << gameInfo;
-
-        return oss.str();
+        initialize(minCapacity);
     }
-};
-
-class Game
-{
-protected:
-    CodeRepo repo;
-    CodeSnippet snippet;
 
-    StatisticsRepo& stats;
-
-    std::string pid;
-
-    int guesses{0};
-    bool fuzzyAllowed=true;
-    bool showPID=false;
-
-public:
-    Game(const CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show):repo(repo),stats(stats),fuzzyAllowed(fuzzy),showPID(show){}
-    
-    virtual ~Game(){};
-
-    virtual bool start()
+    // map the file again when another process grew it; false while another
+    // process rebuilds the table, so it must not be read
+    bool refresh()
     {
-        pid=repo.random();
-        if(pid.empty())
-            return false;
-
-        snippet=repo.loadSnippet(pid,fuzzyAllowed);
+        std::error_code ec;
+        std::uintmax_t size=fs::file_size(path,ec);
+        if(!ec && size>file.size())
+            file.open(path,0);
 
-        return true;
+        return header() -> version == version && fileSize(header() -> capacity) <= file.size();
     }
 
-    std::string currentId()
+    std::uint64_t appliedRecords()
     {
-        return pid;
+        return header() -> appliedRecords;
     }
 
-    int guessCount()
+    // a history record without a game
+    void skip()
     {
-        return guesses;
+        header() -> appliedRecords++;
     }
 
-    std::vector<std::string> getMasked()
+    void setAppliedRecords(std::uint64_t records)
     {
-        return snippet.getMasked();
+        header() -> appliedRecords=records;
     }
 
-    // get time(for example Tue May 13 17:21:15 2025)
-    std::string getTime()
+    // replace the contents with a copy of other, in place
+    void copyFrom(MappedTable& other)
     {
-        auto now=std::chrono::system_clock::now();
-        auto time=std::chrono::system_clock::to_time_t(now);
-
-        std::string result=std::ctime(&time);
-
-        result.pop_back(); // remove '\n'
-        result.push_back(' '); // add space
+        if(file.size()<other.file.size())
+        {
+            file.close();
+            file.open(path,other.file.size());
+        }
 
-        return result;
+        std::memset(file.get(),0,file.size());
+        std::memcpy(file.get(),other.file.get(),other.file.size());
     }
 
-    virtual std::vector<std::string> getGameInfo()
+    void sync()
     {
-        std::vector<std::string> result;
-        result.push_back(std::to_string(guesses)+" guesses\n");
-
-        return result;
+        file.sync();
     }
+};
 
-    virtual std::vector<std::string> getDisplayLines()
-    {
-        std::vector<std::string> result=getGameInfo();
-
-        if(showPID)
-            result.push_back("Problem: www.luogu.com.cn/problem/"+pid);
-
-        auto temp=getMasked();
-        for(auto& line:temp)
-            result.push_back(line);
-
-        result.push_back("Enter your guesses(>= 3 chars), or end the game by entering E, or get an auto guess by entering A");
+// Entry has a used flag, hash() and sameKey(other); a lookup passes an Entry with only the key set
+template<typename Entry>
+class MappedHashTable:public MappedTable<Entry> // open addressing with linear probing, doubled at 3/4 load
+{
+protected:
+    using MappedTable<Entry>::header;
+    using MappedTable<Entry>::entries;
 
-        return result;
+    // the slot of key, or the empty slot where it goes
+    Entry* probe(const Entry& key)
+    {
+        return probe(key,header() -> capacity);
     }
 
-    virtual std::vector<std::string> makeGuess(const std::string& guess)
+    Entry* probe(const Entry& key,std::uint32_t capacity)
     {
-        if(!showPID && guess == "P")
+        std::uint32_t mask=capacity-1;
+        std::uint32_t i=key.hash()&mask;
+        while(true)
         {
-            showPID=true;
-            return {"PID showing enabled"};
-        }
+            Entry* slot=entries()+i;
+            if(!slot -> used || slot -> sameKey(key))
+                return slot;
 
-        if(!fuzzyAllowed && guess == "F")
-        {
-            fuzzyAllowed=true;
-            return {"Fuzzy match enabled"};
+            i=(i+1)&mask;
         }
+    }
 
-        auto result=snippet.guess(guess);
-        
-        // guess is too short
-        if(result[0] == -1)
-            return {"Guess must be at least "+std::to_string(snippet.getMinLen())+" chars"};
-
-        ++guesses;
-
-        int count=revealTimes();
-        while(count--)
-            snippet.reveal();
+    void grow()
+    {
+        std::uint32_t capacity=header() -> capacity*2;
+        std::uint64_t applied=header() -> appliedRecords;
 
-        std::string msg=std::to_string(result[0])+" matches found";
+        std::vector<Entry> used;
+        for(std::uint32_t i=0;i<header() -> capacity;i++)
+            if(entries()[i].used)
+                used.push_back(entries()[i]);
 
-        // fuzzy match
-        if(result[1] != -1)
-            msg += ", "+std::to_string(result[1])+" fuzzy matches found";
+        // rehashed in place; the version is only written back once every entry
+        // is in, so a crash in between gets the table rebuilt
+        this -> resize(capacity);
+        this -> initialize(capacity);
+        header() -> version=0;
 
-        msg += '.';
+        for(auto& entry:used)
+        {
+            *probe(entry)=entry;
+            header() -> count++;
+        }
 
-        return {msg};
+        header() -> appliedRecords=applied;
+        header() -> version=this -> version;
+        this -> file.sync();
     }
 
-    virtual std::string Win()
+    // the entry of key, a new one is a copy of key
+    Entry* insert(const Entry& key)
     {
-        saveStatistics(true);
-
-        return "You win!";
-    }
+        // keep the load factor under 3/4
+        if((header() -> count+1)*4>header() -> capacity*3)
+            grow();
 
-    virtual std::string Lose()
-    {
-        saveStatistics(false);
+        Entry* slot=probe(key);
+        if(!slot -> used)
+        {
+            *slot=key;
+            slot -> used=1;
+            header() -> count++;
+        }
 
-        return "You lose.";
+        return slot;
     }
 
-    virtual bool isFinished()
+    // nullptr if key has no entry; readers do not hold the file lock, so another
+    // process may grow the table meanwhile and only the mapped part is probed
+    Entry* find(const Entry& key)
     {
-        return snippet.check();
+        std::uint32_t capacity=header() -> capacity;
+        if(this -> fileSize(capacity)>this -> file.size())
+            return nullptr;
+
+        Entry* slot=probe(key,capacity);
+        return slot -> used ?slot:nullptr;
     }
 
-    virtual int revealTimes()=0;
-    virtual bool isOver()=0;
-    virtual void saveStatistics(bool)=0;
+public:
+    using MappedTable<Entry>::MappedTable;
 };
 
-class guessLimitedGame:public Game // Guess limited game(for example, 30 guesses)
+class GameRng // xoshiro256**, small and fast; each game owns one, so it replays from its seed
 {
 private:
-    int maxGuesses;
+    std::uint64_t state[4];
 
-    static constexpr int revealGuesses=5;
+    static std::uint64_t rotl(std::uint64_t x,int k)
+    {
+        return (x<<k)|(x>>(64-k));
+    }
 
-public:
-    guessLimitedGame(const CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show):Game(repo,stats,fuzzy,show){};
-    
-    bool start()
+    // SplitMix64 spreads one seed over the four words
+    static std::uint64_t splitMix(std::uint64_t& x)
     {
-        pid=repo.random();
-        if(pid.empty())
-            return false;
-        
-        snippet=repo.loadSnippet(pid,fuzzyAllowed);
+        std::uint64_t z=(x += 0x9e3779b97f4a7c15ull);
+        z=(z^(z>>30))*0xbf58476d1ce4e5b9ull;
+        z=(z^(z>>27))*0x94d049bb133111ebull;
 
-        int total=snippet.getTotalNumber();
-        maxGuesses=std::max(total/3+5,30); // 30 is the minimum number of guesses
+        return z^(z>>31);
+    }
 
-        return true;
+public:
+    explicit GameRng(std::uint64_t seed=0)
+    {
+        reseed(seed);
     }
-    
-    std::vector<std::string> getGameInfo()
+
+    void reseed(std::uint64_t seed)
     {
-        std::vector<std::string> result;
-        result.push_back("Guesses: "+std::to_string(guesses)+"/"+std::to_string(maxGuesses));
+        for(auto& word:state)
+            word=splitMix(seed);
+    }
 
-        return result;
+    // where the sequence is, to save a game and go on with it later
+    std::array<std::uint64_t,4> getState()
+    {
+        return {state[0],state[1],state[2],state[3]};
     }
-    
-    int revealTimes()
+
+    void setState(const std::array<std::uint64_t,4>& words)
     {
-        return guesses%revealGuesses == 0 ?1:0;
+        for(int i=0;i<4;i++)
+            state[i]=words[i];
     }
 
-    bool isOver()
+    // another stream of the same seed, so drawing from one doesn't shift the others
+    static GameRng stream(std::uint64_t seed,std::uint64_t id)
     {
-        return guesses >= maxGuesses;
+        return GameRng(seed^splitMix(id));
     }
 
-    std::string Win()
+    std::uint64_t next()
     {
-        saveStatistics(true);
+        std::uint64_t result=rotl(state[1]*5,7)*9;
+        std::uint64_t t=state[1]<<17;
 
-        return "You win! You only used "+std::to_string(guesses)+" guesses!";
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3]=rotl(state[3],45);
+
+        return result;
     }
 
-    std::string Lose()
+    // uniform in [0,n), the same on every platform unlike std::uniform_int_distribution
+    std::uint32_t below(std::uint32_t n)
     {
-        saveStatistics(false);
+        // Lemire's multiply and shift, rejecting the few biased values
+        std::uint64_t m=(next()>>32)*n;
+        if((std::uint32_t)m<n)
+        {
+            std::uint32_t threshold=(0u-n)%n;
+            while((std::uint32_t)m<threshold)
+                m=(next()>>32)*n;
+        }
 
-        return "You lose. You have used "+std::to_string(guesses)+" guesses.";
+        return (std::uint32_t)(m>>32);
     }
 
-    void saveStatistics(bool isWin)
+    // a seed for a new game, different on every call
+    static std::uint64_t freshSeed()
     {
-        std::string gameType="guessLimited";
-
-        std::string currentTime=getTime();
-        std::string gameShowType="Limited Guesses";
-        std::string gameInfo="guesses: "+std::to_string(guesses)+"/"+std::to_string(maxGuesses)+
-                             " "+(isWin ?"Win":"Lose");
+        thread_local GameRng source(((std::uint64_t)std::random_device{}()<<32)^
+                                    (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+        return source.next();
+    }
+};
 
-        // format the game history line
-        std::string gameHistoryLine=GameHistoryFormatter::format(currentTime,gameShowType,pid,gameInfo);
+// the preprocessed, read-only text of a snippet, shared by all games playing it
+struct SnippetText
+{
+    std::vector<std::string> lines;
+    std::vector<int> offsets{0};   // where each line starts in the guess state, the last one is its size
 
-        stats.addGame(gameHistoryLine,gameType,isWin ?1:0);
-    }
+    int totalNumber{0};         // number of visible characters
+    std::uintmax_t size{0};     // size of the source text in bytes
+    std::uint64_t hash{0};      // FNV-1a of the source text
 };
 
-class timeAttackGame:public Game // Time limited game(for example, 10min)
+class CodeSnippet
 {
 private:
-    int maxTime;
-
-    std::chrono::steady_clock::time_point startTime;
-    std::chrono::steady_clock::time_point lastRevealTime;
+    fs::path path;
 
-    static constexpr int revealTime=10;
+    std::shared_ptr<const SnippetText> text;
+    std::pmr::vector<std::uint8_t> state; // one entry per character, all lines in one block
 
-public:
-    timeAttackGame(const CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show):Game(repo,stats,fuzzy,show){};
-    
-    bool start()
+    std::uint8_t* row(int line)
     {
-        pid=repo.random();
-        if(pid.empty())
-            return false;
-        
-        snippet=repo.loadSnippet(pid,fuzzyAllowed);
+        return state.data()+text -> offsets[line];
+    }
 
-        int total=snippet.getTotalNumber();
-        maxTime=std::max(1.0*total/1.5+10,60.0); // 60 is the minimum time in seconds
+    bool fuzzyAllowed=true;
 
-        startTime=std::chrono::steady_clock::now();
-        lastRevealTime=startTime;
+    static constexpr int MIN_LEN    =3;
+    static constexpr int UNGUESSED  =0;
+    static constexpr int FUZZY_MATCH=1;
+    static constexpr int EXACT_MATCH=2;
+    static constexpr int FUZZY_FAIL =1;
+    static constexpr int FUZZY_COUNT=2;
 
-        return true;
+public:
+    // the guess state is allocated from arena, the text is shared
+    CodeSnippet(std::pmr::memory_resource* arena=std::pmr::get_default_resource()):state(arena){};
+
+    CodeSnippet(const fs::path& filePath,bool fuzzy=true):path(filePath),fuzzyAllowed(fuzzy)
+    {
+        loadFromFile();
     }
-    
-    std::vector<std::string> getGameInfo()
+
+    CodeSnippet(std::shared_ptr<const SnippetText> preprocessed,bool fuzzy=true)
+               :text(std::move(preprocessed)),fuzzyAllowed(fuzzy)
     {
-        std::vector<std::string> result;
+        resetState();
+    }
 
-        auto now=std::chrono::steady_clock::now();
-        auto elapsed=std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+    static std::shared_ptr<const SnippetText> preprocess(const std::string& data)
+    {
+        auto result=std::make_shared<SnippetText>();
+        result -> size=data.size();
+
+        result -> hash=Fnv1a::hash64(data);
+
+        std::istringstream iss(data);
+        std::string line;
+        while(std::getline(iss,line))
+        {
+            // replace '\t' to 4 space
+            const std::string tab4(4,' ');
+            std::size_t pos=0;
+            while((pos=line.find('\t',pos)) != std::string::npos)
+            {
+                line.replace(pos,1,tab4);
+                pos += tab4.size();
+            }
+
+            line.append(MIN_LEN-1,' '); // for all non-empty lines can be guessed
+
+            for(auto& c:line)
+                if(c != ' ')
+                    result -> totalNumber++;
 
-        result.push_back("Time: "+std::to_string(elapsed)+"s/"+std::to_string(maxTime)+"s");
+            result -> lines.push_back(line);
+            result -> offsets.push_back(result -> offsets.back()+(int)line.size());
+        }
 
         return result;
     }
-    
-    int revealTimes()
+
+    void loadFromFile()
     {
-        auto now=std::chrono::steady_clock::now();
+        std::ifstream fin(path);
+        if(!fin)
+            throw AppException("Could not open file: "+path.string());
 
-        int result=std::chrono::duration_cast<std::chrono::seconds>(now-lastRevealTime).count()/revealTime;
-        lastRevealTime += std::chrono::seconds(revealTime*result);
+        // read the file
+        std::string data((std::istreambuf_iterator<char>(fin)),
+                          std::istreambuf_iterator<char>());
 
-        return result;
+        fin.close();
+
+        text=preprocess(data);
+        resetState();
     }
-    
-    bool isOver()
+
+    // start over with another text, keeping the arena
+    void load(std::shared_ptr<const SnippetText> preprocessed,bool fuzzy=true)
     {
-        auto now=std::chrono::steady_clock::now();
-        auto elapsed=std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+        text=std::move(preprocessed);
+        fuzzyAllowed=fuzzy;
 
-        return elapsed >= maxTime;
+        resetState();
     }
-    
-    std::string Win()
-    {
-        saveStatistics(true);
 
-        auto now=std::chrono::steady_clock::now();
-        auto elapsed=std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+    void resetState()
+    {
+        state.assign(text -> offsets.back(),UNGUESSED);
+    }
 
-        return "You win! You only used "+std::to_string(elapsed)+" seconds!";
+    std::uint64_t contentHash()
+    {
+        return text -> hash;
     }
-    
-    std::string Lose()
+
+    bool getFuzzyAllowed()
     {
-        saveStatistics(false);
+        return fuzzyAllowed;
+    }
 
-        auto now=std::chrono::steady_clock::now();
-        auto elapsed=std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+    // 2 bits a character, 4 characters a byte
+    void packState(std::string& out)
+    {
+        std::size_t begin=out.size();
+        out.append((state.size()+3)/4,'\0');
 
-        return "You lose. You have used "+std::to_string(elapsed)+" seconds.";
+        for(std::size_t i=0;i<state.size();i++)
+            out[begin+i/4] |= (char)(state[i]<<(2*(i%4)));
     }
-    
-    void saveStatistics(bool isWin)
+
+    // false if the packed state doesn't fit the text
+    bool unpackState(const char* data,std::size_t size)
     {
-        std::string gameType="timeAttack";
+        if(size != (state.size()+3)/4)
+            return false;
 
-        auto now=std::chrono::steady_clock::now();
-        auto elapsed=std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+        for(std::size_t i=0;i<state.size();i++)
+        {
+            std::uint8_t value=((std::uint8_t)data[i/4]>>(2*(i%4)))&3;
+            if(value>EXACT_MATCH)
+                return false;
 
-        std::string currentTime=getTime();
-        std::string gameShowType="Time Attack";
-        std::string gameInfo="time: "+std::to_string(elapsed)+"s/"+std::to_string(maxTime)+"s "+
-                             (isWin ?"Win":"Lose");
+            state[i]=value;
+        }
 
-        // format the game history line
-        std::string gameHistoryLine=GameHistoryFormatter::format(currentTime,gameShowType,pid,gameInfo);
+        return true;
+    }
 
-        stats.addGame(gameHistoryLine,gameType,isWin ?1:0);
+    int getMinLen()
+    {
+        return MIN_LEN;
     }
-};
 
-class pointGame:public Game // Point game(caculate points based on guesses)
-{
-private:
-    int totalNumber;
-    double points;
+    int getTotalNumber()
+    {
+        // the number of all visible characters is counted once in preprocess
+        return text -> totalNumber;
+    }
 
-    double guessPenalty;
-    double pointFactor;
-    double rewardFactor;
+    int getGuessedNumber()
+    {
+        // get the number of all visible and guessed characters
+        int guessed=0;
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto& line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j<(int)line.size();j++)
+                if(line[j] != ' ' && lineState[j] == EXACT_MATCH)
+                    guessed++;
+        }
 
-    static constexpr double showPidPenalty{0.5};
-    static constexpr double fuzzyPenalty  {0.8};
+        return guessed;
+    }
 
-public:
-    pointGame(const CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show,double penalty=100,double pfactor=500,double rfactor=1.5)
-             :Game(repo,stats,fuzzy,show),points(0)
+    void reveal(GameRng& rng)
     {
-        if(penalty <= 0)
-            throw AppException("Penalty must be positive");
+        // count the hidden characters, then walk to a random one of them
+        int hidden=0;
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto& line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j<(int)line.size();j++)
+                if(line[j] != ' ' && lineState[j] != EXACT_MATCH)
+                    hidden++;
+        }
 
-        if(pfactor <= 0)
-            throw AppException("Point factor must be positive");
+        if(hidden == 0)
+            return;
 
-        if(rfactor<1.0)
-            throw AppException("Reward factor must be not less than 1.0");
+        int pick=(int)rng.below((std::uint32_t)hidden);
 
-        guessPenalty=penalty;
-        pointFactor=pfactor;
-        rewardFactor=rfactor;
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto& line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j<(int)line.size();j++)
+                if(line[j] != ' ' && lineState[j] != EXACT_MATCH && pick-- == 0)
+                {
+                    lineState[j]=EXACT_MATCH;
+                    return;
+                }
+        }
     }
-    
-    bool start()
+
+    std::array<int,2> guess(const std::string& guess)
     {
-        pid=repo.random();
-        if(pid.empty())
-            return false;
+        int len=(int)guess.size();
+        if(len<MIN_LEN)
+            return {-1,-1}; // -1: unguessed
         
-        snippet=repo.loadSnippet(pid,fuzzyAllowed);
-        totalNumber=snippet.getTotalNumber();
+        std::array<int,2> result{};
+        if(!fuzzyAllowed)
+            result[1]=-1;   // -1: fuzzy match not allowed
 
-        return true;
+        // the count of guessed characters(>= 2) is the same at every position
+        int count=0;
+        for(char c:guess)
+            if(c != ' ')
+                count++;
+
+        bool fuzzy=fuzzyAllowed && count >= FUZZY_COUNT;
+        int maxFail=fuzzy ?FUZZY_FAIL:0; // stop comparing once a position can't match any more
+
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto& line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j <= (int)line.size()-len;j++)
+            {
+                const char* p=line.data()+j;
+
+                int failmatch=0;
+                for(int k=0;k<len && failmatch <= maxFail;k++)
+                    if(p[k] != guess[k])
+                        failmatch++;
+
+                if(failmatch == 0)
+                {
+                    result[0]++;
+
+                    // update the state
+                    for(int k=0;k<len;k++)
+                        lineState[j+k]=EXACT_MATCH;
+                    continue;
+                }
+
+                if(failmatch <= maxFail)
+                {
+                    result[1]++;
+
+                    // update the state
+                    for(int k=0;k<len;k++)
+                        if(lineState[j+k] == UNGUESSED)
+                            lineState[j+k]=FUZZY_MATCH;
+                }
+            }
+        }
+        return result;
     }
-    
-    void calcPoint()
+
+    bool check()
     {
-        int guessed=snippet.getGuessedNumber();
+        // check if all characters are guessed
+        bool ok=true;
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto& line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j<(int)line.size();j++)
+                if(line[j] != ' ' && lineState[j] != EXACT_MATCH)
+                {
+                    ok=false;
+                    break;
+                }
+        }
 
-        points=pointFactor*guessed*guessed/totalNumber-
-               guessPenalty*guesses;
-    
-        if(showPID)
-            points *= showPidPenalty;
-        
-        if(fuzzyAllowed)
-            points *= fuzzyPenalty;
-        
-        if(guessed == totalNumber)
-            points *= rewardFactor;
+        return ok;
     }
-    
-    std::vector<std::string> getDisplayLines()
+
+    std::vector<std::string> getMasked(const char& placeholder='@',const char& fuzzyPlaceholder='#')
     {
-        std::vector<std::string> result=getGameInfo();
-        
-        if(showPID)
-            result.push_back("Problem: www.luogu.com.cn/problem/"+pid);
-        
-        auto temp=snippet.getMasked();
-        for(auto& line:temp)
+        // get the masked code
+        std::vector<std::string> result;
+        for(int i=0;i<(int)text -> lines.size();i++)
+        {
+            auto line=text -> lines[i];
+            auto* lineState=row(i);
+            for(int j=0;j<(int)line.size();j++)
+            {
+                if(line[j] == ' ' || lineState[j] == EXACT_MATCH)
+                    continue;
+                if(lineState[j] == UNGUESSED)
+                    line[j]=placeholder;
+                if(lineState[j] == FUZZY_MATCH)
+                    line[j]=fuzzyPlaceholder;
+            }
             result.push_back(line);
-        
-        result.push_back("Enter P to show the problem ID, or F to enable fuzzy match");
-        result.push_back("The game will be easier, but you will get LESS points");
-        result.push_back("Enter your guesses(>= 3 chars), or end the game by entering E");
+        }
 
         return result;
     }
-    
-    std::vector<std::string> getGameInfo()
-    {
-        calcPoint();
+};
 
-        std::vector<std::string> result;
-        result.push_back("Points: "+std::to_string(points));
+class LzCodec // LZ77 with a shared dictionary, token layout similar to LZ4
+{
+private:
+    static constexpr int MIN_MATCH =4;
+    static constexpr int MAX_OFFSET=65535;
+    static constexpr int HASH_BITS =14;
 
-        return result;
-    }
-    
-    int revealTimes()
+    static std::uint32_t hashAt(const std::string& buf,std::size_t i)
     {
-        // never reveal
-        return 0;
+        std::uint32_t v=(std::uint8_t)buf[i] | (std::uint8_t)buf[i+1]<<8 |
+                        (std::uint8_t)buf[i+2]<<16 | (std::uint32_t)(std::uint8_t)buf[i+3]<<24;
+
+        return (v*2654435761u)>>(32-HASH_BITS);
     }
-    
-    bool isOver()
+
+    static void writeLength(std::string& out,std::size_t len)
     {
-        // you can guess forever
-        return false;
+        while(len >= 255)
+        {
+            out.push_back((char)255);
+            len -= 255;
+        }
+        out.push_back((char)len);
     }
 
-    std::string Win()
+    static std::size_t readLength(const std::string& in,std::size_t& pos)
     {
-        saveStatistics(true);
-
-        calcPoint();
+        std::size_t len=0;
+        while(true)
+        {
+            if(pos >= in.size())
+                throw AppException("Corrupted compressed data");
 
-        return "You achieved "+std::to_string(points)+" points!";
+            std::uint8_t b=in[pos++];
+            len += b;
+            if(b != 255)
+                return len;
+        }
     }
 
-    std::string Lose()
+    static void emit(std::string& out,const char* literals,std::size_t litLen,std::size_t offset,std::size_t matchLen)
     {
-        // there's no "Lose" in point mode, 
-        // even if your points is negative
+        std::size_t extra=matchLen == 0 ?0:matchLen-MIN_MATCH;
+
+        out.push_back((char)(std::min<std::size_t>(litLen,15)<<4 | std::min<std::size_t>(extra,15)));
+        if(litLen >= 15)
+            writeLength(out,litLen-15);
 
-        return Win();
+        out.append(literals,litLen);
+
+        // the last sequence has literals only
+        if(matchLen == 0)
+            return;
+
+        out.push_back((char)(offset&255));
+        out.push_back((char)(offset>>8));
+        if(extra >= 15)
+            writeLength(out,extra-15);
     }
 
-    void saveStatistics(bool isWin)
+public:
+    static constexpr std::size_t MAX_DICT=32*1024;
+
+    static std::string compress(const std::string& input,const std::string& dict)
     {
-        calcPoint();
+        // the dictionary is treated as data already seen in front of the input
+        std::string buf=dict.substr(dict.size()-std::min(dict.size(),MAX_DICT))+input;
+        std::size_t base=buf.size()-input.size();
+        std::size_t n=buf.size();
+
+        std::vector<int> table(1<<HASH_BITS,-1);
+        for(std::size_t i=0;i+MIN_MATCH <= base;i++)
+            table[hashAt(buf,i)]=(int)i;
+
+        std::string out;
+        std::size_t anchor=base,i=base;
+        while(i+MIN_MATCH <= n)
+        {
+            auto h=hashAt(buf,i);
+            int cand=table[h];
+            table[h]=(int)i;
 
-        std::string gameType="point";
+            if(cand<0 || i-cand>MAX_OFFSET || buf.compare(cand,MIN_MATCH,buf,i,MIN_MATCH) != 0)
+            {
+                i++;
+                continue;
+            }
 
-        std::string currentTime=getTime();
-        std::string gameShowType="Point";
-        std::string gameInfo="points: "+std::to_string(points)+
-                               " "+(isWin ?"Win":"Lose");
-        
-        // format the game history line
-        std::string gameHistoryLine=GameHistoryFormatter::format(currentTime,gameShowType,pid,gameInfo);
+            std::size_t len=MIN_MATCH;
+            while(i+len<n && buf[cand+len] == buf[i+len])
+                len++;
 
-        stats.addGame(gameHistoryLine,gameType,points);
-    }
-};
+            emit(out,buf.data()+anchor,i-anchor,i-cand,len);
 
-class AutoGuess
-{
-private:
-    const std::string alphabet_="abcdefghijklmnopqrstuvwxyz0123456789_^(){};%=<>+-*&|\"";
+            for(std::size_t k=i+1;k<i+len && k+MIN_MATCH <= n;k++)
+                table[hashAt(buf,k)]=(int)k;
 
-    const char placeholder='@';
-    const char fuzzyholder='#';
+            i += len;
+            anchor=i;
+        }
 
-    const int guessLength=3;
-    
-    const std::vector<std::string> keywords=
-    {
-        "int","for","if(","els","ret","urn","cla","ass","nam","esp",
-        "#in","ude","std","siz","lon","eof","nul","ptr","new","del",
-        "ete","whi","ile","con","st ","cou","t<<","cin",">> ","%d ",
-        "sca","pri","ntf","<<\"", "\"<<"
-    };
-    
-    int count;
+        emit(out,buf.data()+anchor,n-anchor,0,0);
 
-public:
-    AutoGuess():count(0){};
+        return out;
+    }
 
-    std::string guess(const std::vector<std::string>& mask)
+    static std::string decompress(const std::string& in,std::size_t rawSize,const std::string& dict)
     {
-        if(count == (int)keywords.size())
-            return random();
+        std::string out;
+        out.reserve(rawSize);
 
-        bool visited=false;
-        for(auto& line:mask)
+        std::size_t pos=0;
+        while(pos<in.size())
         {
-            for(int i=0;i <= (int)line.size()-guessLength;i++)
-                if(line.substr(i,guessLength) == keywords[count])
-                    visited=true;
+            std::uint8_t token=in[pos++];
+
+            std::size_t litLen=token>>4;
+            if(litLen == 15)
+                litLen += readLength(in,pos);
+
+            if(pos+litLen>in.size())
+                throw AppException("Corrupted compressed data");
+
+            out.append(in,pos,litLen);
+            pos += litLen;
+
+            if(pos == in.size())
+                break;
+
+            if(pos+2>in.size())
+                throw AppException("Corrupted compressed data");
+
+            std::size_t offset=(std::uint8_t)in[pos] | (std::uint8_t)in[pos+1]<<8;
+            pos += 2;
+
+            std::size_t matchLen=(token&15)+MIN_MATCH;
+            if((token&15) == 15)
+                matchLen += readLength(in,pos);
+
+            if(offset == 0 || offset>out.size()+dict.size() || out.size()+matchLen>rawSize)
+                throw AppException("Corrupted compressed data");
+
+            // byte by byte, the match may overlap itself or start inside the dictionary
+            for(std::size_t k=0;k<matchLen;k++)
+            {
+                std::size_t from=dict.size()+out.size()-offset;
+                out.push_back(from >= dict.size() ?out[from-dict.size()]:dict[from]);
+            }
         }
 
-        count++;
+        if(out.size() != rawSize)
+            throw AppException("Corrupted compressed data");
 
-        if(visited)
-            return guess(mask);
-        
-        return keywords[count-1];
+        return out;
     }
 
-    std::string random()
+    // build a dictionary from the lines that appear most often in the samples
+    static std::string train(const std::vector<std::string>& samples,std::size_t maxSize=MAX_DICT)
     {
-        std::string result;
-        
-        // use random number generator to get a random index
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dist(0,(int)alphabet_.size()-1);
+        std::unordered_map<std::string,int> freq;
+        for(auto& sample:samples)
+        {
+            std::istringstream iss(sample);
+            std::string line;
+            while(std::getline(iss,line))
+            {
+                auto first=line.find_first_not_of(" \t");
+                if(first == std::string::npos || line.size()-first<MIN_MATCH)
+                    continue;
 
-        for(int i=0;i<guessLength;i++)
-            result += alphabet_[dist(gen)];
-        
-        return result;
+                freq[line.substr(first)+'\n']++;
+            }
+        }
+
+        std::vector<std::pair<long long,std::string> > candidates;
+        for(auto& item:freq)
+            if(item.second >= 2)
+                candidates.emplace_back(1LL*item.second*(long long)item.first.size(),item.first);
+
+        std::sort(candidates.begin(),candidates.end(),
+                  [](auto& a,auto& b){return a.first != b.first ?a.first>b.first:a.second<b.second;});
+
+        std::vector<std::string> picked;
+        std::size_t size=0;
+        for(auto& item:candidates)
+        {
+            if(size+item.second.size()>maxSize)
+                continue;
+
+            picked.push_back(item.second);
+            size += item.second.size();
+        }
+
+        // the most valuable lines go last, closest to the data
+        std::string dict;
+        for(auto it=picked.rbegin();it != picked.rend();it++)
+            dict += *it;
+
+        return dict;
     }
 };
 
-class UI
+// the puzzle every player gets on one day, built once and shared read-only by all its games
+struct DailyPuzzle
+{
+    std::int64_t day{0};   // days since the unix epoch in UTC
+    std::string pid;
+    std::uint64_t seed{0}; // the same reveals for everyone
+    std::shared_ptr<const SnippetText> text;
+};
+
+class CodeRepo
 {
 private:
     fs::path root;
-    CodeRepo repo;
+    bool sharded=false;
+    bool compressed=false;
+    std::string ext=".txt";
 
-    StatisticsRepo stats;
+    std::vector<std::string> cacheVec; // sorted pids
 
-    bool showPID=true;
+    // shared by all snippets in compressed mode, trained on the corpus
+    std::shared_ptr<const std::string> dictionary=std::make_shared<const std::string>();
+    std::uint64_t dictionaryHash=Fnv1a::hash64("");
 
-public:
-    UI()
+    // preprocessed snippets, shared by all copies of the repo(every Game holds one)
+    struct SnippetCache
     {
-        root=fs::current_path();
+        std::mutex mtx;
+        std::unordered_map<std::string,std::shared_ptr<const SnippetText> > texts;
+        std::unordered_map<std::uint64_t,std::shared_ptr<const std::string> > dictionaries; // older ones, by hash
 
-        repo=CodeRepo(root/"CodeSnippets");
-
-        stats=StatisticsRepo(root/"Statistics.dat");
+        std::mutex dailyMtx;                      // the first game of a day builds the puzzle
+        std::shared_ptr<const DailyPuzzle> daily; // read with std::atomic_load, no lock
     };
-    
-    void clearScreen()
+    std::shared_ptr<SnippetCache> cache=std::make_shared<SnippetCache>();
+
+    static constexpr const char* MANIFEST  ="MANIFEST";
+    static constexpr const char* JOURNAL   ="MANIFEST.log";  // "+pid" and "-pid" lines since the manifest was written
+    static constexpr const char* LOCK      ="MANIFEST.lock"; // held by any process changing the manifest
+    static constexpr const char* LAYOUT    ="LAYOUT";
+    static constexpr const char* DICTIONARY="DICTIONARY";
+    static constexpr const char* LZ_MAGIC  ="CWLZ";
+    static constexpr int LZ_HEADER   =16; // magic, raw size(u32), dictionary hash(u64)
+    static constexpr std::uintmax_t JOURNAL_MIN=4096;
+    static constexpr std::uint64_t DAILY_STREAM=3;
+    static constexpr int WARMUP_CHUNK=64;
+    static constexpr int MAX_PID     =32; // the records keep this much of an ID, see GameRecord
+
+    void invalidate(const std::string& pid)
     {
-    #ifdef _WIN32
-        // for backward compatibility
-        std::cout << "\x1B[2J\x1B[H";
-        std::cout << "\x1B[3J";
-    #else
-        std::cout << "\x1B[2J\x1B[H\x1B[3J";
-    #endif
+        {
+            std::lock_guard<std::mutex> lock(cache -> mtx);
+            cache -> texts.erase(pid);
+        }
 
-        std::cout.flush();
+        // any change to the snippets may change the pick of the day, or its text
+        std::lock_guard<std::mutex> lock(cache -> dailyMtx);
+        std::atomic_store(&cache -> daily,std::shared_ptr<const DailyPuzzle>());
     }
-    
-    void pause()
+
+    // a longer ID would be cut in the game records and mixed up with another one
+    static bool validPid(const std::string& pid)
+    {
+        return !pid.empty() && (int)pid.size() <= MAX_PID;
+    }
+
+    static void checkPid(const std::string& pid)
+    {
+        bool valid=validPid(pid);
+        for(char c:pid)
+            valid=valid && (std::isalnum((unsigned char)c) || c == '_' || c == '-');
+
+        // the ID becomes a file name
+        if(!valid)
+            throw AppException("Invalid code ID: "+pid);
+    }
+
+    void refresh()
+    {
+        cacheVec.clear();
+
+        for(auto& e:fs::directory_iterator(root))
+            if(e.is_regular_file() && e.path().extension() == ext)
+            {
+                auto pid=e.path().stem().string();
+                if(validPid(pid))
+                    cacheVec.push_back(pid);
+                else
+                    std::cerr << "Code ID too long, skipped: " << e.path().string() << '\n';
+            }
+
+        std::sort(cacheVec.begin(),cacheVec.end());
+    }
+
+    // the layout a repo was converted to is remembered, so every entry point opens it
+    // the same way; returns whether the caller asked for more than was saved
+    bool loadLayout()
+    {
+        bool savedSharded=false;
+        bool savedCompressed=false;
+
+        std::ifstream fin(root/LAYOUT);
+        std::string word;
+        while(fin >> word)
+        {
+            if(word == "sharded")
+                savedSharded=true;
+            else if(word == "compressed")
+                savedCompressed=true;
+        }
+
+        bool changed=(sharded && !savedSharded) || (compressed && !savedCompressed);
+        sharded=sharded || savedSharded;
+        compressed=compressed || savedCompressed;
+
+        return changed;
+    }
+
+    void saveLayout()
+    {
+        std::string data;
+        if(sharded)
+            data += "sharded\n";
+        if(compressed)
+            data += "compressed\n";
+
+        writeFile(root/LAYOUT,data,false);
+    }
+
+    // the manifest with the journal folded in, the last change of a pid wins; under the lock
+    bool readManifest()
+    {
+        std::ifstream fin(root/MANIFEST);
+        if(!fin)
+            return false;
+
+        cacheVec.clear();
+
+        std::string pid;
+        while(std::getline(fin,pid))
+            if(!pid.empty())
+                cacheVec.push_back(pid);
+
+        fin.close();
+
+        std::map<std::string,bool> changes;
+
+        std::ifstream journal(root/JOURNAL);
+        std::string line;
+        while(std::getline(journal,line))
+        {
+            // a line cut by a crash has no newline, the change it was for never finished
+            if(journal.eof() || line.size()<2 || (line[0] != '+' && line[0] != '-'))
+                continue;
+
+            changes[line.substr(1)]=(line[0] == '+');
+        }
+
+        if(changes.empty())
+            return true;
+
+        std::vector<std::string> merged;
+        merged.reserve(cacheVec.size()+changes.size());
+
+        auto it=cacheVec.begin();
+        for(auto& [id,present]:changes)
+        {
+            while(it != cacheVec.end() && *it<id)
+                merged.push_back(*it++);
+
+            if(it != cacheVec.end() && *it == id)
+                it++;
+
+            if(present)
+                merged.push_back(id);
+        }
+        merged.insert(merged.end(),it,cacheVec.end());
+
+        cacheVec.swap(merged);
+
+        return true;
+    }
+
+    void loadManifest()
+    {
+        FileLock lock(root/LOCK);
+
+        // first start in sharded mode, build the manifest once
+        if(!readManifest())
+            rebuildManifest();
+    }
+
+    // writes cacheVec as the new manifest and drops the journal it includes; under the lock
+    void saveManifest()
+    {
+        // write to a temporary file first, so a crash never leaves a half manifest
+        auto temp=root/(std::string(MANIFEST)+".tmp");
+
+        std::ofstream fout(temp);
+        if(!fout)
+            throw AppException("Could not open file: "+temp.string());
+
+        for(auto& pid:cacheVec)
+            fout << pid << '\n';
+
+        fout.close();
+
+        fs::rename(temp,root/MANIFEST);
+
+        // a crash before this only replays changes the manifest already has
+        fs::remove(root/JOURNAL);
+    }
+
+    // a change is one appended line; once the journal outgrows the manifest, both are
+    // folded into a new manifest, so changes cost O(1) on average
+    void journalChange(char op,const std::string& pid)
+    {
+        FileLock lock(root/LOCK);
+
+        auto path=root/JOURNAL;
+
+        // drop the line a crash left behind, the change it was for never finished
+        std::ifstream fin(path,std::ios::binary|std::ios::ate);
+        if(fin && fin.tellg()>0)
+        {
+            fin.seekg(-1,std::ios::end);
+            if(fin.get() != '\n')
+            {
+                fin.seekg(0);
+                std::string data((std::istreambuf_iterator<char>(fin)),
+                                  std::istreambuf_iterator<char>());
+                fin.close();
+
+                fs::resize_file(path,data.rfind('\n')+1);
+            }
+        }
+        fin.close();
+
+        std::ofstream fout(path,std::ios::binary|std::ios::app);
+        if(!fout)
+            throw AppException("Could not open file: "+path.string());
+
+        fout << op << pid << '\n';
+        fout.close();
+
+        std::error_code ec;
+        auto journalSize=fs::file_size(path,ec);
+        auto manifestSize=fs::file_size(root/MANIFEST,ec);
+        if(ec || journalSize<JOURNAL_MIN || journalSize<manifestSize)
+            return;
+
+        // other processes may have changed it too, so fold in what is on disk
+        readManifest();
+        saveManifest();
+    }
+
+    void rebuildManifest()
+    {
+        cacheVec.clear();
+
+        std::vector<fs::path> files;
+        for(auto& e:fs::recursive_directory_iterator(root))
+            if(e.is_regular_file() && e.path().extension() == ext)
+                files.push_back(e.path());
+
+        for(auto& file:files)
+        {
+            auto pid=file.stem().string();
+            if(!validPid(pid))
+            {
+                std::cerr << "Code ID too long, skipped: " << file.string() << '\n';
+                continue;
+            }
+
+            auto target=makePath(pid);
+
+            // move the files of a flat repository into their shards
+            if(file != target)
+            {
+                fs::create_directories(target.parent_path());
+                fs::rename(file,target);
+            }
+
+            cacheVec.push_back(pid);
+        }
+
+        std::sort(cacheVec.begin(),cacheVec.end());
+        cacheVec.erase(std::unique(cacheVec.begin(),cacheVec.end()),cacheVec.end());
+
+        saveManifest();
+    }
+
+    static std::string readFile(const fs::path& path,bool binary=true)
+    {
+        std::ifstream fin(path,binary ?std::ios::in|std::ios::binary:std::ios::in);
+        std::string data((std::istreambuf_iterator<char>(fin)),
+                          std::istreambuf_iterator<char>());
+
+        return data;
+    }
+
+    // write to a temporary file first, so a crash leaves either the old or the new file
+    static void writeFile(const fs::path& path,const std::string& data,bool binary=true)
+    {
+        auto temp=path;
+        temp += ".tmp";
+
+        std::ofstream fout(temp,binary ?std::ios::out|std::ios::binary:std::ios::out);
+        if(!fout)
+            throw AppException("Could not open file: "+temp.string());
+
+        fout.write(data.data(),data.size());
+        fout.close();
+        if(!fout)
+            throw AppException("Could not write file: "+temp.string());
+
+        fs::rename(temp,path);
+    }
+
+    // every dictionary a snippet was ever compressed with is kept under its hash,
+    // DICTIONARY is only the one new snippets are written with
+    fs::path dictionaryPath(std::uint64_t hash)
+    {
+        static const char hex[]="0123456789abcdef";
+
+        std::string name=std::string(DICTIONARY)+'.';
+        for(int i=60;i >= 0;i -= 4)
+            name.push_back(hex[(hash>>i)&15]);
+
+        return root/name;
+    }
+
+    void loadDictionary()
+    {
+        auto data=readFile(root/DICTIONARY);
+
+        dictionary=std::make_shared<const std::string>(data);
+        dictionaryHash=Fnv1a::hash64(data);
+
+        // written by a version that kept one dictionary only
+        if(!fs::exists(dictionaryPath(dictionaryHash)))
+            writeFile(dictionaryPath(dictionaryHash),data);
+    }
+
+    // switching is the last step of a training, the snippets already point at the new one
+    void saveDictionary(const std::string& data)
+    {
+        writeFile(root/DICTIONARY,data);
+
+        dictionary=std::make_shared<const std::string>(data);
+        dictionaryHash=Fnv1a::hash64(data);
+    }
+
+    std::shared_ptr<const std::string> findDictionary(const fs::path& path,std::uint64_t hash)
+    {
+        if(hash == dictionaryHash)
+            return dictionary;
+
+        {
+            std::lock_guard<std::mutex> lock(cache -> mtx);
+            auto it=cache -> dictionaries.find(hash);
+            if(it != cache -> dictionaries.end())
+                return it -> second;
+        }
+
+        auto file=dictionaryPath(hash);
+        auto data=readFile(file);
+        if(!fs::exists(file) || Fnv1a::hash64(data) != hash)
+            throw AppException("Snippet was compressed with a missing dictionary: "+path.string());
+
+        std::lock_guard<std::mutex> lock(cache -> mtx);
+        return cache -> dictionaries.emplace(hash,std::make_shared<const std::string>(data)).first -> second;
+    }
+
+    static std::string encode(const std::string& data,const std::string& dict,std::uint64_t dictHash)
+    {
+        std::string file(LZ_MAGIC,4);
+        for(int i=0;i<4;i++)
+            file.push_back((char)((std::uint32_t)data.size()>>(8*i)));
+        for(int i=0;i<8;i++)
+            file.push_back((char)(dictHash>>(8*i)));
+
+        file += LzCodec::compress(data,dict);
+        return file;
+    }
+
+    void writeSnippet(const fs::path& path,const std::string& data)
+    {
+        if(!compressed)
+            writeFile(path,data,false);
+        else
+            writeFile(path,encode(data,*dictionary,dictionaryHash));
+    }
+
+    std::string decode(const fs::path& path,const std::string& file)
+    {
+        if(file.size()<LZ_HEADER || file.compare(0,4,LZ_MAGIC) != 0)
+            throw AppException("Not a compressed snippet: "+path.string());
+
+        std::uint32_t rawSize=0;
+        std::uint64_t dictHash=0;
+        for(int i=0;i<4;i++)
+            rawSize |= (std::uint32_t)(std::uint8_t)file[4+i]<<(8*i);
+        for(int i=0;i<8;i++)
+            dictHash |= (std::uint64_t)(std::uint8_t)file[8+i]<<(8*i);
+
+        auto dict=findDictionary(path,dictHash);
+        return LzCodec::decompress(file.substr(LZ_HEADER),rawSize,*dict);
+    }
+
+    void migrateToCompressed()
+    {
+        // first start in compressed mode: train on the plain snippets and convert them;
+        // DICTIONARY is written last, so an interrupted run starts over with the files left
+        std::vector<fs::path> files;
+        for(auto& e:fs::recursive_directory_iterator(root))
+            if(e.is_regular_file() && e.path().extension() == ".txt")
+                files.push_back(e.path());
+
+        std::vector<std::string> samples;
+        for(auto& file:files)
+            samples.push_back(readFile(file,false));
+
+        auto trained=LzCodec::train(samples);
+        dictionary=std::make_shared<const std::string>(trained);
+        dictionaryHash=Fnv1a::hash64(trained);
+        writeFile(dictionaryPath(dictionaryHash),trained);
+
+        for(int i=0;i<(int)files.size();i++)
+        {
+            auto target=makePath(files[i].stem().string());
+
+            fs::create_directories(target.parent_path());
+            writeSnippet(target,samples[i]);
+            fs::remove(files[i]);
+        }
+
+        saveDictionary(trained);
+    }
+
+public:
+    CodeRepo(){};
+
+    // sharded: store snippets as ab/cd/pid.txt and keep a sorted manifest,
+    // so the startup never walks the directory tree
+    // compressed: store snippets as pid.lz, compressed against a shared dictionary
+    CodeRepo(const fs::path& dir,bool shardedLayout=false,bool compressedStorage=false)
+            :root(dir),sharded(shardedLayout),compressed(compressedStorage)
+    {
+        if(!fs::exists(root))
+            fs::create_directories(root);
+
+        // saved before converting, an interrupted conversion is finished by the next start
+        if(loadLayout())
+            saveLayout();
+
+        if(compressed)
+        {
+            ext=".lz";
+
+            if(fs::exists(root/DICTIONARY))
+                loadDictionary();
+            else
+                migrateToCompressed();
+        }
+        
+        if(sharded)
+            loadManifest();
+        else
+            refresh();
+    };
+
+    fs::path makePath(const std::string& pid)
+    {
+        if(!sharded)
+            return root/(pid+ext);
+
+        static const char hex[]="0123456789abcdef";
+
+        auto h=Fnv1a::hash32(pid);
+        std::string level1{hex[(h>>4)&15],hex[h&15]};
+        std::string level2{hex[(h>>12)&15],hex[(h>>8)&15]};
+
+        return root/level1/level2/(pid+ext);
+    }
+
+    std::vector<std::string> list()
+    {
+        return cacheVec;
+    }
+
+    void add(const std::string& pid,const std::vector<std::string> lines)
+    {
+        checkPid(pid);
+
+        auto path=makePath(pid);
+
+        if(sharded)
+            fs::create_directories(path.parent_path());
+
+        std::string data;
+        for(auto& line:lines)
+            data += line+'\n';
+
+        writeSnippet(path,data);
+
+        invalidate(pid);
+
+        if(!sharded)
+        {
+            refresh();
+            return;
+        }
+
+        // journaled even when known here, another process may have removed it
+        auto it=std::lower_bound(cacheVec.begin(),cacheVec.end(),pid);
+        if(it == cacheVec.end() || *it != pid)
+            cacheVec.insert(it,pid);
+
+        journalChange('+',pid);
+    }
+
+    bool remove(const std::string& pid)
+    {
+        auto path=makePath(pid);
+
+        bool ok=fs::remove(path);
+        if(!ok)
+            return false;
+
+        invalidate(pid);
+
+        if(!sharded)
+        {
+            refresh();
+            return true;
+        }
+
+        auto it=std::lower_bound(cacheVec.begin(),cacheVec.end(),pid);
+        if(it != cacheVec.end() && *it == pid)
+            cacheVec.erase(it);
+
+        journalChange('-',pid);
+
+        return true;
+    }
+
+    std::string read(const std::string& pid)
+    {
+        auto path=makePath(pid);
+
+        std::string data=readFile(path,compressed);
+        if(!compressed || data.empty())
+            return data;
+
+        return decode(path,data);
+    }
+
+    // retrain the shared dictionary on the current corpus and recompress every snippet;
+    // each snippet names its dictionary and the old ones are kept, so a crash
+    // halfway leaves a mix that still reads, and other copies of the repo
+    // may go on writing with the dictionary they loaded
+    void trainDictionary()
+    {
+        if(!compressed)
+            return;
+
+        std::vector<std::string> samples;
+        for(auto& pid:cacheVec)
+            samples.push_back(read(pid));
+
+        auto trained=LzCodec::train(samples);
+        auto trainedHash=Fnv1a::hash64(trained);
+        writeFile(dictionaryPath(trainedHash),trained);
+
+        for(int i=0;i<(int)cacheVec.size();i++)
+            writeFile(makePath(cacheVec[i]),encode(samples[i],trained,trainedHash));
+
+        saveDictionary(trained);
+    }
+
+    std::string random(GameRng& rng)
+    {
+        if(cacheVec.empty()) 
+            return {};
+
+        return cacheVec[rng.below((std::uint32_t)cacheVec.size())];
+    }
+
+    // the same snippet for every player on a day, nullptr when the repo is empty;
+    // after the first game of the day, starting one only copies a pointer
+    std::shared_ptr<const DailyPuzzle> daily(std::int64_t day)
+    {
+        auto puzzle=std::atomic_load(&cache -> daily);
+        if(puzzle && puzzle -> day == day)
+            return puzzle;
+
+        std::lock_guard<std::mutex> lock(cache -> dailyMtx);
+
+        puzzle=std::atomic_load(&cache -> daily);
+        if(puzzle && puzzle -> day == day)
+            return puzzle;
+
+        // the day alone decides, so every server with the same snippets agrees
+        GameRng rng=GameRng::stream((std::uint64_t)day,DAILY_STREAM);
+        std::string pid=random(rng);
+        if(pid.empty())
+            return nullptr;
+
+        auto built=std::make_shared<DailyPuzzle>();
+        built -> day=day;
+        built -> pid=pid;
+        built -> seed=rng.next();
+        built -> text=loadText(pid);
+
+        // an older day is built for the caller only, the cache keeps the newest
+        if(!puzzle || puzzle -> day<day)
+            std::atomic_store(&cache -> daily,std::shared_ptr<const DailyPuzzle>(built));
+
+        return built;
+    }
+
+    // a few random snippets for a game to choose from, none when the repo is empty;
+    // pids is refilled in place, so a reused one allocates nothing
+    void candidates(GameRng& rng,std::vector<std::string>& pids,int count=8)
+    {
+        pids.clear();
+        if(cacheVec.empty())
+            return;
+
+        for(int i=0;i<count;i++)
+            pids.push_back(random(rng));
+    }
+
+    std::shared_ptr<const SnippetText> loadText(const std::string& pid)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cache -> mtx);
+            auto it=cache -> texts.find(pid);
+            if(it != cache -> texts.end())
+                return it -> second;
+        }
+
+        auto path=makePath(pid);
+        if(!fs::exists(path))
+            throw AppException("Could not open file: "+path.string());
+
+        auto text=CodeSnippet::preprocess(read(pid));
+
+        std::lock_guard<std::mutex> lock(cache -> mtx);
+        return cache -> texts.emplace(pid,text).first -> second;
+    }
+
+    CodeSnippet loadSnippet(const std::string& pid, bool fuzzy=true)
+    {
+        return CodeSnippet(loadText(pid),fuzzy);
+    }
+
+    // read and preprocess every snippet on a thread pool, so that no game has to touch the disk,
+    // progress(done,total) is called from the worker threads, but never concurrently;
+    // a snippet that can't be read is reported and left to fail in its own game,
+    // returns how many of them there were
+    int warmUp(const std::function<void(int,int)>& progress={},unsigned threads=std::thread::hardware_concurrency())
+    {
+        int total=(int)cacheVec.size();
+
+        std::atomic<int> next{0};
+        std::atomic<int> failed{0};
+        std::mutex progressMtx;
+        int done=0;
+
+        ThreadPool pool(threads);
+        for(int t=0;t<pool.size();t++)
+        {
+            pool.submit([&]
+            {
+                std::vector<std::pair<std::string,std::shared_ptr<const SnippetText> > > local;
+
+                while(true)
+                {
+                    int begin=next.fetch_add(WARMUP_CHUNK);
+                    if(begin >= total)
+                        break;
+
+                    int end=std::min(begin+WARMUP_CHUNK,total);
+
+                    local.clear();
+                    for(int i=begin;i<end;i++)
+                    {
+                        auto& pid=cacheVec[i];
+
+                        // a stale manifest entry should not stop the warm-up
+                        std::error_code ec;
+                        if(!fs::is_regular_file(makePath(pid),ec))
+                            continue;
+
+                        // nothing may escape a pool task, it would end the process
+                        try
+                        {
+                            local.emplace_back(pid,CodeSnippet::preprocess(read(pid)));
+                        }
+                        catch(const std::exception& e)
+                        {
+                            failed++;
+
+                            std::lock_guard<std::mutex> lock(progressMtx);
+                            std::cerr << pid << ": " << e.what() << '\n';
+                        }
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(cache -> mtx);
+                        for(auto& item:local)
+                            cache -> texts[item.first]=item.second;
+                    }
+
+                    std::lock_guard<std::mutex> lock(progressMtx);
+                    done += end-begin;
+                    if(progress)
+                        progress(done,total);
+                }
+            });
+        }
+
+        pool.wait();
+        return failed;
+    }
+};
+
+enum class GameMode:std::uint8_t
+{
+    GuessLimited=0,
+    TimeAttack  =1,
+    Point       =2
+};
+
+// one finished game, trivially copyable so that queueing it never allocates
+struct GameRecord
+{
+    static constexpr int PID_SIZE  =32; // CodeRepo rejects longer IDs
+    static constexpr int FLAG_FUZZY=1; // fuzzy match was enabled
+    static constexpr int FLAG_PID  =2; // problem ID was shown
+    static constexpr int FLAG_DAILY=4; // the daily challenge
+
+    std::int64_t time{0};       // unix time when the game ended
+    double points{0};
+    std::int32_t guesses{0};
+    std::int32_t seconds{0};
+    std::int32_t limit{0};      // max guesses or max seconds, 0 for point games
+    GameMode mode{GameMode::GuessLimited};
+    std::uint8_t result{0};     // 1 win, 0 lose
+    std::uint8_t flags{0};
+    std::uint8_t pidLen{0};
+    char pid[PID_SIZE]{};
+
+    void setPid(const std::string& id)
+    {
+        pidLen=(std::uint8_t)std::min((int)id.size(),PID_SIZE);
+        std::memcpy(pid,id.data(),pidLen);
+    }
+
+    std::string getPid() const
+    {
+        return std::string(pid,pidLen);
+    }
+
+    // days since the unix epoch in UTC
+    static std::int64_t dayOf(std::int64_t time)
+    {
+        // floor division, days before 1970 are negative
+        return time >= 0 ?time/86400:-((-time+86399)/86400);
+    }
+
+    static std::int64_t today()
+    {
+        auto now=std::chrono::system_clock::now();
+        return dayOf(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+    }
+
+    // the day of the daily challenge a game played, it's picked when the game starts
+    std::int64_t startDay() const
+    {
+        return dayOf(time-seconds);
+    }
+};
+
+struct LittleEndian
+{
+    static void put(char* p,std::uint64_t v,int bytes)
+    {
+        for(int i=0;i<bytes;i++)
+            p[i]=(char)(v>>(8*i));
+    }
+
+    static std::uint64_t get(const char* p,int bytes)
+    {
+        std::uint64_t v=0;
+        for(int i=0;i<bytes;i++)
+            v |= (std::uint64_t)(std::uint8_t)p[i]<<(8*i);
+
+        return v;
+    }
+
+    static void putDouble(char* p,double d)
+    {
+        std::uint64_t v;
+        std::memcpy(&v,&d,sizeof(v));
+        put(p,v,8);
+    }
+
+    static double getDouble(const char* p)
+    {
+        std::uint64_t v=get(p,8);
+        double d;
+        std::memcpy(&d,&v,sizeof(d));
+
+        return d;
+    }
+};
+
+struct GameHistoryFormatter
+{   
+    static constexpr int timeWidth    =26;
+    static constexpr int gameTypeWidth=18;
+    static constexpr int pidWidth     =7;
+    static constexpr int bufferSize   =512;
+
+    static char* append(char* p,const char* s)
+    {
+        while(*s)
+            *p++=*s++;
+
+        return p;
+    }
+
+    static char* appendInt(char* p,char* end,long long v,int width=0,char fill=' ')
+    {
+        char digits[24];
+        auto res=std::to_chars(digits,digits+sizeof(digits),v);
+
+        for(int n=(int)(res.ptr-digits);n<width && p<end;n++)
+            *p++=fill;
+
+        return std::copy(digits,res.ptr,p);
+    }
+
+    static char* padTo(char* begin,char* p,int width)
+    {
+        while(p-begin<width)
+            *p++=' ';
+
+        return p;
+    }
+
+    // the same layout as ctime(for example Tue May 13 17:21:15 2025)
+    static char* appendTime(char* p,char* end,std::int64_t time)
+    {
+        static const char* days[]={"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
+        static const char* months[]={"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+
+        std::time_t t=(std::time_t)time;
+        std::tm tm{};
+    #ifdef _WIN32
+        localtime_s(&tm,&t);
+    #else
+        localtime_r(&t,&tm);
+    #endif
+
+        p=append(p,days[tm.tm_wday%7]);
+        *p++=' ';
+        p=append(p,months[tm.tm_mon%12]);
+        *p++=' ';
+        p=appendInt(p,end,tm.tm_mday,2);
+        *p++=' ';
+        p=appendInt(p,end,tm.tm_hour,2,'0');
+        *p++=':';
+        p=appendInt(p,end,tm.tm_min,2,'0');
+        *p++=':';
+        p=appendInt(p,end,tm.tm_sec,2,'0');
+        *p++=' ';
+        p=appendInt(p,end,tm.tm_year+1900);
+
+        return p;
+    }
+
+    // records are stored as structs and only formatted when they are displayed, for example
+    // "Tue May 13 17:21:15 2025  Limited Guesses   P1000  guesses: 5/30 Win"
+    static std::string format(const GameRecord& record)
+    {
+        char buf[bufferSize];
+        char* end=buf+bufferSize;
+
+        char* p=appendTime(buf,end,record.time);
+        p=padTo(buf,p,timeWidth);
+
+        char* column=p;
+        switch(record.mode)
+        {
+            case GameMode::GuessLimited:
+                p=append(p,"Limited Guesses");
+                break;
+            case GameMode::TimeAttack:
+                p=append(p,"Time Attack");
+                break;
+            case GameMode::Point:
+                p=append(p,"Point");
+                break;
+        }
+        p=padTo(column,p,gameTypeWidth);
+
+        column=p;
+        p=std::copy(record.pid,record.pid+record.pidLen,p);
+        p=padTo(column,p,pidWidth);
+
+        switch(record.mode)
+        {
+            case GameMode::GuessLimited:
+                p=append(p,"guesses: ");
+                p=appendInt(p,end,record.guesses);
+                *p++='/';
+                p=appendInt(p,end,record.limit);
+                *p++=' ';
+                break;
+            case GameMode::TimeAttack:
+                p=append(p,"time: ");
+                p=appendInt(p,end,record.seconds);
+                p=append(p,"s/");
+                p=appendInt(p,end,record.limit);
+                p=append(p,"s ");
+                break;
+            case GameMode::Point:
+            {
+                p=append(p,"points: ");
+
+                auto res=std::to_chars(p,end-8,record.points,std::chars_format::fixed,6);
+                if(res.ec != std::errc())
+                    res=std::to_chars(p,end-8,record.points);
+
+                p=res.ptr;
+                *p++=' ';
+                break;
+            }
+        }
+
+        p=append(p,record.result ?"Win":"Lose");
+
+        return std::string(buf,p);
+    }
+};
+
+struct RunningStat // Welford's online mean and variance
+{
+    double mean{0};
+    double m2{0};
+
+    // n is the number of samples including x
+    void add(double x,std::uint32_t n)
+    {
+        double delta=x-mean;
+        mean += delta/n;
+        m2 += delta*(x-mean);
+    }
+
+    double variance(std::uint32_t n) const
+    {
+        return n>1 ?m2/(n-1):0;
+    }
+};
+
+struct QuantileSketch // HDR-style log-linear histogram, constant size and mergeable by adding counts
+{
+    static constexpr int SCALE   =4;           // values are bucketed in quarters, points and seconds can be fractional
+    static constexpr int SUB_BITS=3;
+    static constexpr int SUB     =1<<SUB_BITS; // scaled magnitudes below SUB have exact buckets
+    static constexpr int HALF    =SUB/2;       // buckets per octave above that(<= 12.5% wide)
+    static constexpr int MAX_BITS=26;          // larger magnitudes share the last bucket
+    static constexpr int SIDE    =SUB+(MAX_BITS-SUB_BITS)*HALF;
+
+    std::uint64_t total;
+    double minValue;
+    double maxValue;
+
+    // negative magnitudes mirrored in front of the positive ones, so the buckets are in value order
+    std::uint32_t buckets[2*SIDE];
+
+    // magnitude is already scaled
+    static int bucketOf(double magnitude)
+    {
+        if(magnitude >= (double)(1u<<MAX_BITS))
+            return SIDE-1;
+
+        std::uint32_t m=(std::uint32_t)magnitude;
+        if(m<SUB)
+            return (int)m;
+
+        int k=0;
+        while((m>>(k+1)) != 0)
+            k++;
+
+        int sub=(int)(m>>(k-SUB_BITS+1))-HALF;
+
+        return SUB+(k-SUB_BITS)*HALF+sub;
+    }
+
+    // the smallest scaled magnitude and the width of a bucket
+    static void bucketRange(int idx,double& low,double& width)
+    {
+        if(idx<SUB)
+        {
+            low=idx;
+            width=1;
+            return;
+        }
+
+        int k=SUB_BITS+(idx-SUB)/HALF;
+        int sub=(idx-SUB)%HALF;
+
+        low=(double)((std::uint32_t)(HALF+sub)<<(k-SUB_BITS+1));
+        width=(double)(1u<<(k-SUB_BITS+1));
+    }
+
+    void add(double value)
+    {
+        minValue=total == 0 ?value:std::min(minValue,value);
+        maxValue=total == 0 ?value:std::max(maxValue,value);
+        total++;
+
+        if(value<0)
+            buckets[SIDE-1-bucketOf(-value*SCALE)]++;
+        else
+            buckets[SIDE+bucketOf(value*SCALE)]++;
+    }
+
+    void merge(const QuantileSketch& other)
+    {
+        if(other.total == 0)
+            return;
+
+        minValue=total == 0 ?other.minValue:std::min(minValue,other.minValue);
+        maxValue=total == 0 ?other.maxValue:std::max(maxValue,other.maxValue);
+        total += other.total;
+
+        for(int i=0;i<2*SIDE;i++)
+            buckets[i] += other.buckets[i];
+    }
+
+    std::uint64_t count() const
+    {
+        return total;
+    }
+
+    // q in [0,1], interpolated inside the bucket
+    double quantile(double q) const
+    {
+        std::uint64_t n=count();
+        if(n == 0)
+            return 0;
+
+        // the extremes are known exactly
+        if(q <= 0)
+            return minValue;
+        if(q >= 1)
+            return maxValue;
+
+        double rank=q*(double)(n-1);
+        std::uint64_t seen=0;
+        for(int i=0;i<2*SIDE;i++)
+        {
+            if(buckets[i] == 0 || (double)(seen+buckets[i]) <= rank)
+            {
+                seen += buckets[i];
+                continue;
+            }
+
+            double low,width;
+            bucketRange(i<SIDE ?SIDE-1-i:i-SIDE,low,width);
+
+            double fraction=width == 1 ?0:(rank-(double)seen+0.5)/buckets[i];
+
+            // a negative bucket holds its largest magnitude first in value order
+            if(i<SIDE && width != 1)
+                fraction=1-fraction;
+
+            double magnitude=(low+fraction*width)/SCALE;
+
+            return std::clamp(i<SIDE ?-magnitude:magnitude,minValue,maxValue);
+        }
+
+        return 0;
+    }
+};
+
+struct SketchBlock // the sketches of guesses, seconds and points of one mode or one snippet
+{
+    static constexpr int GUESSES=0;
+    static constexpr int SECONDS=1;
+    static constexpr int POINTS =2;
+    static constexpr int METRICS=3;
+
+    QuantileSketch metric[METRICS];
+};
+
+class SketchStore:public MappedTable<SketchBlock> // one block per mode and per snippet, the header count is the number of blocks
+{
+public:
+    using Block=SketchBlock;
+
+    static constexpr int GUESSES=Block::GUESSES;
+    static constexpr int SECONDS=Block::SECONDS;
+    static constexpr int POINTS =Block::POINTS;
+
+    // blocks 0..2 belong to the game modes, snippets get the blocks after them
+    static constexpr std::uint32_t MODE_BLOCKS=3;
+
+private:
+    void reserveModes()
+    {
+        if(header() -> count<MODE_BLOCKS)
+            header() -> count=MODE_BLOCKS;
+    }
+
+public:
+    SketchStore():MappedTable("CWQS",2,64){};
+
+    void open(const fs::path& filePath)
+    {
+        MappedTable::open(filePath);
+        reserveModes();
+    }
+
+    void reset()
+    {
+        MappedTable::reset();
+        reserveModes();
+    }
+
+    std::uint32_t allocate()
+    {
+        if(header() -> count == header() -> capacity)
+        {
+            // blocks are only appended, so growing is just mapping a bigger file
+            std::uint32_t capacity=header() -> capacity*2;
+            resize(capacity);
+            header() -> capacity=capacity;
+        }
+
+        return header() -> count++;
+    }
+
+    void add(const GameRecord& record,std::uint32_t snippetBlock)
+    {
+        for(std::uint32_t b:{(std::uint32_t)record.mode,snippetBlock})
+        {
+            Block& block=entries()[b];
+            block.metric[GUESSES].add(record.guesses);
+            block.metric[SECONDS].add(record.seconds);
+            block.metric[POINTS].add(record.points);
+        }
+
+        header() -> appliedRecords++;
+    }
+
+    bool get(std::uint32_t index,Block& result)
+    {
+        if(index >= header() -> count || fileSize(index+1)>file.size())
+            return false;
+
+        result=entries()[index];
+        return true;
+    }
+};
+
+struct SnippetAggregate
+{
+    char pid[GameRecord::PID_SIZE];
+    std::uint8_t pidLen;
+    std::uint8_t used;
+    std::uint16_t reserved;
+
+    std::uint32_t plays;
+    std::uint32_t wins;
+    std::uint32_t fuzzyGames;   // games played with fuzzy match enabled
+    std::uint32_t pidShownGames;// games played with the problem ID shown
+    std::uint32_t sketchBlock;  // quantile sketches in the SketchStore, 0 if none yet
+
+    RunningStat guesses;
+    RunningStat seconds;
+    RunningStat points;
+
+    static SnippetAggregate key(const char* id,int len)
+    {
+        SnippetAggregate entry{};
+        entry.pidLen=(std::uint8_t)std::min(len,GameRecord::PID_SIZE);
+        std::memcpy(entry.pid,id,entry.pidLen);
+
+        return entry;
+    }
+
+    std::uint32_t hash() const
+    {
+        return Fnv1a::hash32(pid,pidLen);
+    }
+
+    bool sameKey(const SnippetAggregate& other) const
+    {
+        return pidLen == other.pidLen && std::memcmp(pid,other.pid,pidLen) == 0;
+    }
+};
+
+class SnippetStatsTable:public MappedHashTable<SnippetAggregate> // per-pid aggregates in a mapped file
+{
+public:
+    SnippetStatsTable():MappedHashTable("CWAG",1,1024){};
+
+    SnippetAggregate* add(const GameRecord& record)
+    {
+        SnippetAggregate* slot=insert(SnippetAggregate::key(record.pid,record.pidLen));
+
+        std::uint32_t n=++slot -> plays;
+        slot -> wins += record.result;
+        slot -> fuzzyGames += (record.flags&GameRecord::FLAG_FUZZY) ?1:0;
+        slot -> pidShownGames += (record.flags&GameRecord::FLAG_PID) ?1:0;
+
+        slot -> guesses.add(record.guesses,n);
+        slot -> seconds.add(record.seconds,n);
+        slot -> points.add(record.points,n);
+
+        header() -> appliedRecords++;
+
+        return slot;
+    }
+
+    bool find(const std::string& pid,SnippetAggregate& result)
+    {
+        SnippetAggregate* slot=MappedHashTable::find(SnippetAggregate::key(pid.data(),(int)pid.size()));
+        if(!slot)
+            return false;
+
+        result=*slot;
+        return true;
+    }
+};
+
+struct LeaderEntry
+{
+    double value;
+    std::int64_t time;
+    char user[GameRecord::PID_SIZE];
+    char pid[GameRecord::PID_SIZE];
+    std::uint8_t userLen;
+    std::uint8_t pidLen;
+    std::uint8_t reserved[6];
+
+    std::string getUser() const
+    {
+        return std::string(user,userLen);
+    }
+
+    std::string getPid() const
+    {
+        return std::string(pid,pidLen);
+    }
+};
+
+// one metric of one pid, an empty pid for the global board;
+// entries[0] is the worst one, so a better game replaces it in O(log K)
+struct Leaderboard
+{
+    static constexpr int K=10;
+
+    char pid[GameRecord::PID_SIZE];
+    std::uint8_t pidLen;
+    std::uint8_t metric;
+    std::uint8_t used;
+    std::uint8_t reserved;
+    std::uint32_t size;
+    LeaderEntry entries[K];
+
+    static Leaderboard key(int metric,const char* id,int len)
+    {
+        Leaderboard board{};
+        board.metric=(std::uint8_t)metric;
+        board.pidLen=(std::uint8_t)std::min(len,GameRecord::PID_SIZE);
+        std::memcpy(board.pid,id,board.pidLen);
+
+        return board;
+    }
+
+    std::uint32_t hash() const
+    {
+        return Fnv1a::hash32(pid,pidLen,Fnv1a::BASIS32^metric);
+    }
+
+    bool sameKey(const Leaderboard& other) const
+    {
+        return metric == other.metric && pidLen == other.pidLen && std::memcmp(pid,other.pid,pidLen) == 0;
+    }
+};
+
+class LeaderboardTable:public MappedHashTable<Leaderboard> // top-K boards per metric, global and per pid, as bounded heaps
+{
+public:
+    static constexpr int POINTS =0; // best points of the point games
+    static constexpr int GUESSES=1; // fewest guesses of the won limited guesses games
+    static constexpr int SECONDS=2; // fastest won time attack games
+    static constexpr int METRICS=3;
+
+    static constexpr int K=Leaderboard::K;
+
+    // the board of a day's daily challenge sits among the pid boards, '@' is never in a pid
+    static std::string dailyKey(std::int64_t day)
+    {
+        return "@"+std::to_string(day);
+    }
+
+private:
+    static bool better(int metric,const LeaderEntry& a,const LeaderEntry& b)
+    {
+        if(a.value != b.value)
+            return metric == POINTS ?a.value>b.value:a.value<b.value;
+
+        // the earlier game keeps its place on a tie
+        return a.time<b.time;
+    }
+
+    static void siftUp(int metric,LeaderEntry* heap,int i)
+    {
+        while(i>0 && better(metric,heap[(i-1)/2],heap[i]))
+        {
+            std::swap(heap[(i-1)/2],heap[i]);
+            i=(i-1)/2;
+        }
+    }
+
+    static void siftDown(int metric,LeaderEntry* heap,int size,int i)
+    {
+        while(true)
+        {
+            int worst=i;
+            for(int child:{2*i+1,2*i+2})
+                if(child<size && better(metric,heap[worst],heap[child]))
+                    worst=child;
+
+            if(worst == i)
+                return;
+
+            std::swap(heap[i],heap[worst]);
+            i=worst;
+        }
+    }
+
+    static void push(Leaderboard* board,const LeaderEntry& entry)
+    {
+        LeaderEntry* heap=board -> entries;
+        if(board -> size<(std::uint32_t)K)
+        {
+            heap[board -> size]=entry;
+            siftUp(board -> metric,heap,board -> size++);
+        }
+        else
+            if(better(board -> metric,entry,heap[0]))
+            {
+                heap[0]=entry;
+                siftDown(board -> metric,heap,K,0);
+            }
+    }
+
+public:
+    // K is kept in the header, boards of another size are rebuilt
+    LeaderboardTable():MappedHashTable("CWLB",1,64,K){};
+
+    // the metric a game competes in, -1 if it does not make a leaderboard
+    static int metricOf(const GameRecord& record,double& value)
+    {
+        if(record.mode == GameMode::Point)
+        {
+            value=record.points;
+            return POINTS;
+        }
+
+        if(!record.result)
+            return -1;
+
+        value=record.mode == GameMode::GuessLimited ?record.guesses:record.seconds;
+        return record.mode == GameMode::GuessLimited ?GUESSES:SECONDS;
+    }
+
+    // O(log K) for the global board and the board of the pid
+    void add(const GameRecord& record,const std::string& user="")
+    {
+        header() -> appliedRecords++;
+
+        double value;
+        int metric=metricOf(record,value);
+        if(metric<0)
+            return;
+
+        LeaderEntry entry{};
+        entry.value=value;
+        entry.time=record.time;
+        entry.userLen=(std::uint8_t)std::min((int)user.size(),GameRecord::PID_SIZE);
+        std::memcpy(entry.user,user.data(),entry.userLen);
+        entry.pidLen=record.pidLen;
+        std::memcpy(entry.pid,record.pid,record.pidLen);
+
+        push(insert(Leaderboard::key(metric,"",0)),entry);
+        push(insert(Leaderboard::key(metric,record.pid,record.pidLen)),entry);
+
+        // a game that showed the ID doesn't compete with the others of the day
+        if((record.flags&GameRecord::FLAG_DAILY) && !(record.flags&GameRecord::FLAG_PID))
+        {
+            std::string key=dailyKey(record.startDay());
+            push(insert(Leaderboard::key(metric,key.data(),(int)key.size())),entry);
+        }
+    }
+
+    // the best first, pid empty for the global board
+    std::vector<LeaderEntry> top(int metric,const std::string& pid="")
+    {
+        std::vector<LeaderEntry> result;
+
+        Leaderboard* board=find(Leaderboard::key(metric,pid.data(),(int)pid.size()));
+        if(!board)
+            return result;
+
+        result.assign(board -> entries,board -> entries+std::min<std::uint32_t>(board -> size,K));
+        std::sort(result.begin(),result.end(),[metric](const LeaderEntry& a,const LeaderEntry& b)
+        {
+            return better(metric,a,b);
+        });
+
+        return result;
+    }
+};
+
+struct LeaderboardFormatter
+{
+    static constexpr const char* titles[]={"Best Points","Fewest Guesses","Fastest Time Attack"};
+    static constexpr const char* units[] ={" points"," guesses","s"};
+
+    // for example " 1. 5 guesses  P1000  alice  Tue May 13 17:21:15 2025"
+    static std::string format(int rank,int metric,const LeaderEntry& entry)
+    {
+        std::string value=metric == LeaderboardTable::POINTS ?std::to_string(entry.value):
+                                                              std::to_string((long long)entry.value);
+
+        std::string line=(rank<10 ?" ":"")+std::to_string(rank)+". "+value+units[metric];
+        line += "  "+entry.getPid();
+        if(entry.userLen)
+            line += "  "+entry.getUser();
+
+        char buf[GameHistoryFormatter::bufferSize];
+        char* end=GameHistoryFormatter::appendTime(buf,buf+sizeof(buf),entry.time);
+
+        return line+"  "+std::string(buf,end);
+    }
+
+    // every metric of one board, pid empty for the global ones
+    template<typename TopFn>
+    static std::vector<std::string> formatAll(TopFn top)
+    {
+        std::vector<std::string> result;
+        for(int metric=0;metric<LeaderboardTable::METRICS;metric++)
+        {
+            auto entries=top(metric);
+            if(entries.empty())
+                continue;
+
+            result.push_back(std::string(titles[metric])+":");
+            for(int i=0;i<(int)entries.size();i++)
+                result.push_back(format(i+1,metric,entries[i]));
+        }
+
+        if(result.empty())
+            result.push_back("No leaderboard entries yet");
+
+        return result;
+    }
+};
+
+struct RatingEntry
+{
+    char name[GameRecord::PID_SIZE]; // a user, or the pid of a snippet
+    std::uint8_t nameLen;
+    std::uint8_t kind;
+    std::uint8_t used;
+    std::uint8_t reserved;
+    std::uint32_t games;
+
+    double rating;
+    double deviation;
+    std::int64_t lastTime;  // unix time of the last rated game
+
+    std::uint32_t hash() const
+    {
+        return Fnv1a::hash32(name,nameLen,Fnv1a::BASIS32^kind);
+    }
+
+    bool sameKey(const RatingEntry& other) const
+    {
+        return kind == other.kind && nameLen == other.nameLen && std::memcmp(name,other.name,nameLen) == 0;
+    }
+};
+
+class RatingTable:public MappedHashTable<RatingEntry> // Glicko ratings of players and snippets, each game is a match between them
+{
+public:
+    static constexpr int PLAYER =0;
+    static constexpr int SNIPPET=1;
+
+    static constexpr double INITIAL_RATING   =1500;
+    static constexpr double INITIAL_DEVIATION=350;
+    static constexpr double MIN_DEVIATION    =30;
+    static constexpr double DEVIATION_GROWTH =34.6; // per idle day, back to 350 from 50 after 100 days
+
+private:
+    // the deviation grows while a player or snippet is idle
+    static double currentDeviation(const RatingEntry& entry,std::int64_t time)
+    {
+        if(!entry.games)
+            return entry.deviation;
+
+        double days=std::max<std::int64_t>(0,time-entry.lastTime)/86400.0;
+        return std::min(INITIAL_DEVIATION,std::sqrt(entry.deviation*entry.deviation+
+                                                    DEVIATION_GROWTH*DEVIATION_GROWTH*days));
+    }
+
+    // Glicko-1 for a single game against one opponent
+    static void update(RatingEntry& self,double rd,double opponentRating,double opponentRd,double score)
+    {
+        static const double q=std::log(10.0)/400;
+        static const double pi=std::acos(-1.0);
+
+        double g=1/std::sqrt(1+3*q*q*opponentRd*opponentRd/(pi*pi));
+        double expected=1/(1+std::pow(10.0,-g*(self.rating-opponentRating)/400));
+        double d2=1/(q*q*g*g*expected*(1-expected));
+        double denominator=1/(rd*rd)+1/d2;
+
+        self.rating += q/denominator*g*(score-expected);
+        self.deviation=std::max(MIN_DEVIATION,std::sqrt(1/denominator));
+    }
+
+public:
+    RatingTable():MappedHashTable("CWRT",1,1024){};
+
+    static RatingEntry unrated(int kind,const std::string& name)
+    {
+        RatingEntry entry{};
+        entry.nameLen=(std::uint8_t)std::min((int)name.size(),GameRecord::PID_SIZE);
+        std::memcpy(entry.name,name.data(),entry.nameLen);
+        entry.kind=(std::uint8_t)kind;
+        entry.rating=INITIAL_RATING;
+        entry.deviation=INITIAL_DEVIATION;
+
+        return entry;
+    }
+
+    // O(1), the player wins the match by winning the game
+    void add(const GameRecord& record,const std::string& player="")
+    {
+        header() -> appliedRecords++;
+
+        RatingEntry playerKey=unrated(PLAYER,player);
+        insert(playerKey);
+
+        // adding the snippet may grow the table, so the player is looked up after it
+        RatingEntry* snippet=insert(unrated(SNIPPET,std::string(record.pid,record.pidLen)));
+        RatingEntry* self=probe(playerKey);
+
+        // both sides are rated from their ratings before the game
+        double selfRating=self -> rating,snippetRating=snippet -> rating;
+        double selfRd=currentDeviation(*self,record.time),snippetRd=currentDeviation(*snippet,record.time);
+
+        update(*self,selfRd,snippetRating,snippetRd,record.result ?1:0);
+        update(*snippet,snippetRd,selfRating,selfRd,record.result ?0:1);
+
+        for(RatingEntry* side:{self,snippet})
+        {
+            side -> games++;
+            side -> lastTime=std::max(side -> lastTime,record.time);
+        }
+    }
+
+    // an unrated entry if there were no games yet
+    RatingEntry get(int kind,const std::string& name)
+    {
+        RatingEntry key=unrated(kind,name);
+
+        RatingEntry* slot=find(key);
+        return slot ?*slot:key;
+    }
+
+    // a player and a few snippets in one read, all unrated while another
+    // process rebuilds the table
+    RatingEntry getPick(const std::string& player,const std::vector<std::string>& pids,std::vector<RatingEntry>& snippets)
+    {
+        bool valid=refresh();
+
+        snippets.clear();
+        for(auto& pid:pids)
+            snippets.push_back(valid ?get(SNIPPET,pid):unrated(SNIPPET,pid));
+
+        return valid ?get(PLAYER,player):unrated(PLAYER,player);
+    }
+};
+
+struct DailyAggregate
+{
+    std::int64_t day;       // days since 1970-01-01, UTC
+    std::int64_t games[3];  // by GameMode
+    std::int64_t wins[3];
+    double points;
+    std::int64_t guesses;
+    std::int64_t seconds;
+};
+
+class DailyRollupTable:public MappedTable<DailyAggregate> // per-day totals of the compacted history, sorted by day
+{
+private:
+    // the entry of day, inserted in order when it is new
+    DailyAggregate* entry(std::int64_t day)
+    {
+        DailyAggregate* begin=entries();
+        DailyAggregate* end=begin+header() -> count;
+        DailyAggregate* it=std::lower_bound(begin,end,day,[](const DailyAggregate& a,std::int64_t d){return a.day<d;});
+        if(it != end && it -> day == day)
+            return it;
+
+        std::size_t index=it-begin;
+        if(header() -> count == header() -> capacity)
+        {
+            std::uint32_t capacity=header() -> capacity*2;
+            resize(capacity);
+            header() -> capacity=capacity;
+        }
+
+        // the history is mostly in time order, so this is nearly always an append
+        it=entries()+index;
+        std::memmove(it+1,it,(header() -> count-index)*sizeof(DailyAggregate));
+        std::memset((void*)it,0,sizeof(DailyAggregate));
+        it -> day=day;
+        header() -> count++;
+
+        return it;
+    }
+
+public:
+    DailyRollupTable():MappedTable("CWDY",1,256){};
+
+    static void add(DailyAggregate& day,const GameRecord& record)
+    {
+        int m=(int)record.mode%3;
+        day.games[m]++;
+        day.wins[m] += record.result;
+        day.guesses += record.guesses;
+        day.seconds += record.seconds;
+
+        if(record.mode == GameMode::Point)
+            day.points += record.points;
+    }
+
+    void add(const GameRecord& record)
+    {
+        add(*entry(GameRecord::dayOf(record.time)),record);
+        header() -> appliedRecords++;
+    }
+
+    // the days in [fromDay,toDay], oldest first; another process may have
+    // grown the table meanwhile, so only the mapped part is read
+    std::vector<DailyAggregate> get(std::int64_t fromDay,std::int64_t toDay)
+    {
+        std::size_t mapped=(file.size()-HEADER_SIZE)/sizeof(DailyAggregate);
+        DailyAggregate* begin=entries();
+        DailyAggregate* end=begin+std::min<std::size_t>(header() -> count,mapped);
+        DailyAggregate* it=std::lower_bound(begin,end,fromDay,[](const DailyAggregate& a,std::int64_t d){return a.day<d;});
+
+        std::vector<DailyAggregate> result;
+        for(;it != end && it -> day <= toDay;it++)
+            result.push_back(*it);
+
+        return result;
+    }
+};
+
+template<typename T,std::size_t CAPACITY>
+class MpscQueue // bounded, lock-free for the producers, one consumer at a time
+{
+private:
+    static_assert((CAPACITY&(CAPACITY-1)) == 0,"CAPACITY must be a power of 2");
+
+    struct Cell
+    {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(64) std::atomic<std::size_t> tail{0}; // next position to push
+    alignas(64) std::size_t head{0};              // next position to pop
+
+public:
+    MpscQueue():cells(new Cell[CAPACITY])
+    {
+        for(std::size_t i=0;i<CAPACITY;i++)
+            cells[i].seq.store(i,std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value)
+    {
+        std::size_t pos=tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true)
+        {
+            cell=&cells[pos&(CAPACITY-1)];
+            std::size_t seq=cell -> seq.load(std::memory_order_acquire);
+            auto diff=(std::intptr_t)seq-(std::intptr_t)pos;
+
+            if(diff == 0)
+            {
+                if(tail.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                    break;
+            }
+            else
+                if(diff<0)
+                    return false; // full
+                else
+                    pos=tail.load(std::memory_order_relaxed);
+        }
+
+        cell -> value=value;
+        cell -> seq.store(pos+1,std::memory_order_release);
+
+        return true;
+    }
+
+    bool tryPop(T& value)
+    {
+        Cell* cell=&cells[head&(CAPACITY-1)];
+        std::size_t seq=cell -> seq.load(std::memory_order_acquire);
+        if((std::intptr_t)seq-(std::intptr_t)(head+1)<0)
+            return false; // empty, or the producer has not finished writing
+
+        value=std::move(cell -> value);
+        cell -> seq.store(head+CAPACITY,std::memory_order_release);
+        head++;
+
+        return true;
+    }
+};
+
+// what the writer thread does with the queued games
+class StatisticsSink
+{
+public:
+    virtual ~StatisticsSink(){};
+
+    virtual void apply(const GameRecord& record)=0;
+    virtual void persist()=0;
+};
+
+class StatisticsWriter // batches finished games and saves them off the game thread
+{
+private:
+    struct Event
+    {
+        StatisticsSink* target{nullptr};
+        GameRecord record;
+        bool game{true}; // false for a save request without a game
+    };
+
+    MpscQueue<Event,4096> queue;
+
+    std::mutex drainMtx;   // the queue has one consumer at a time
+    std::mutex wakeMtx;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+
+    std::chrono::milliseconds interval;
+    std::thread worker;
+
+    void run()
+    {
+        while(!stopping.load())
+        {
+            {
+                std::unique_lock<std::mutex> lock(wakeMtx);
+                wake.wait_for(lock,interval);
+            }
+
+            drain();
+        }
+
+        drain();
+    }
+
+public:
+    StatisticsWriter(std::chrono::milliseconds flushInterval=std::chrono::milliseconds(500))
+                    :interval(flushInterval)
+    {
+        worker=std::thread([this]{run();});
+    }
+
+    StatisticsWriter(const StatisticsWriter&)=delete;
+    StatisticsWriter& operator=(const StatisticsWriter&)=delete;
+
+    ~StatisticsWriter()
+    {
+        stopping.store(true);
+        wake.notify_one();
+
+        worker.join();
+    }
+
+    void push(StatisticsSink* target,const GameRecord& record)
+    {
+        Event event;
+        event.target=target;
+        event.record=record;
+
+        // never blocks on disk, only waits for the writer when the queue is full
+        while(!queue.tryPush(event))
+        {
+            wake.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    // have target saved soon without a game, never blocks; false when the queue is full
+    bool requestSave(StatisticsSink* target)
+    {
+        Event event;
+        event.target=target;
+        event.game=false;
+
+        if(!queue.tryPush(event))
+            return false;
+
+        wake.notify_one();
+        return true;
+    }
+
+    // apply every queued game, then save each touched target once
+    void drain()
+    {
+        std::lock_guard<std::mutex> lock(drainMtx);
+
+        std::vector<StatisticsSink*> touched;
+
+        Event event;
+        while(queue.tryPop(event))
+        {
+            if(event.game)
+                event.target -> apply(event.record);
+
+            if(std::find(touched.begin(),touched.end(),event.target) == touched.end())
+                touched.push_back(event.target);
+        }
+
+        for(auto* target:touched)
+        {
+            try
+            {
+                target -> persist();
+            }
+            catch(const std::exception& e)
+            {
+                // nobody to report to on the writer thread
+                std::cerr << e.what() << '\n';
+            }
+        }
+    }
+};
+
+struct HistoryQuery
+{
+    int mode  =-1;      // a GameMode, -1 for any
+    int result=-1;      // 1 win, 0 lose, -1 for any
+    std::string pid;    // empty for any
+    std::int64_t from=std::numeric_limits<std::int64_t>::min(); // unix time range, inclusive
+    std::int64_t to  =std::numeric_limits<std::int64_t>::max();
+
+    std::int64_t before=-1; // only records older than this id, -1 for the newest, updated by each query
+
+    // only the games of the last days, days <= 0 for any time
+    void lastDays(int days)
+    {
+        if(days <= 0)
+            return;
+
+        auto now=std::chrono::system_clock::now();
+        to=std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        from=to-(std::int64_t)days*24*60*60;
+    }
+};
+
+class HistoryIndex // secondary indexes over the saved history, by record id
+{
+private:
+    std::vector<std::int64_t> times;
+    std::vector<std::int64_t> maxTimes;    // prefix maximum of times, for the binary search
+    std::vector<std::uint8_t> modeResults; // mode in the low bits, result in bit 7
+    std::vector<std::uint32_t> pidIds;
+
+    std::unordered_map<std::string,std::uint32_t> pidNames;
+    std::vector<std::vector<std::uint32_t> > byPid;
+    std::vector<std::uint32_t> byMode[3];
+    std::vector<std::uint32_t> byResult[2];
+
+    std::int64_t base{0}; // id of the first indexed record, the older ones were compacted
+
+    static constexpr std::uint8_t HOLE=0x7f; // in modeResults, never matches
+
+public:
+    std::int64_t size()
+    {
+        return (std::int64_t)times.size();
+    }
+
+    std::int64_t first()
+    {
+        return base;
+    }
+
+    // the id of the next record to add
+    std::int64_t end()
+    {
+        return base+size();
+    }
+
+    void clear(std::int64_t firstId=0)
+    {
+        *this=HistoryIndex();
+        base=firstId;
+    }
+
+    void add(const GameRecord& record)
+    {
+        std::uint32_t id=(std::uint32_t)times.size();
+
+        auto it=pidNames.emplace(record.getPid(),(std::uint32_t)byPid.size()).first;
+        if(it -> second == byPid.size())
+            byPid.emplace_back();
+
+        times.push_back(record.time);
+        maxTimes.push_back(maxTimes.empty() ?record.time:std::max(maxTimes.back(),record.time));
+        modeResults.push_back((std::uint8_t)((std::uint8_t)record.mode|(record.result ?0x80:0)));
+        pidIds.push_back(it -> second);
+
+        byPid[it -> second].push_back(id);
+        byMode[(int)record.mode%3].push_back(id);
+        byResult[record.result ?1:0].push_back(id);
+    }
+
+    // a history slot without a game, keeps the ids in step with the history
+    void addHole()
+    {
+        times.push_back(maxTimes.empty() ?0:maxTimes.back());
+        maxTimes.push_back(times.back());
+        modeResults.push_back(HOLE);
+        pidIds.push_back(std::numeric_limits<std::uint32_t>::max());
+    }
+
+    // ids of at most limit matching records, the newest first
+    std::vector<std::int64_t> find(const HistoryQuery& q,int limit)
+    {
+        std::vector<std::int64_t> result;
+
+        std::int64_t end=q.before<0 ?size():std::min(q.before-base,size());
+        if(end <= 0)
+            return result;
+
+        // the times are appended in order, the prefix maximum keeps the search exact
+        // for the lower end even when the clock went backwards
+        std::int64_t begin=std::lower_bound(maxTimes.begin(),maxTimes.begin()+end,q.from)-maxTimes.begin();
+        end=std::upper_bound(maxTimes.begin()+begin,maxTimes.begin()+end,q.to)-maxTimes.begin();
+
+        int pidId=-1;
+        if(!q.pid.empty())
+        {
+            auto it=pidNames.find(q.pid);
+            if(it == pidNames.end())
+                return result;
+
+            pidId=(int)it -> second;
+        }
+
+        // walk the smallest posting list, and check the other filters on the columns
+        const std::vector<std::uint32_t>* list=nullptr;
+        auto consider=[&](const std::vector<std::uint32_t>& candidate)
+        {
+            if(!list || candidate.size()<list -> size())
+                list=&candidate;
+        };
+
+        if(q.mode >= 0 && q.mode<3)
+            consider(byMode[q.mode]);
+        if(q.result >= 0)
+            consider(byResult[q.result ?1:0]);
+        if(pidId >= 0)
+            consider(byPid[pidId]);
+
+        auto matches=[&](std::uint32_t id)
+        {
+            if(modeResults[id] == HOLE)
+                return false;
+            if(q.mode >= 0 && (modeResults[id]&0x7f) != q.mode)
+                return false;
+            if(q.result >= 0 && (modeResults[id]>>7) != (q.result ?1:0))
+                return false;
+            if(pidId >= 0 && pidIds[id] != (std::uint32_t)pidId)
+                return false;
+
+            return times[id] >= q.from && times[id] <= q.to;
+        };
+
+        if(list)
+        {
+            auto lo=std::lower_bound(list -> begin(),list -> end(),(std::uint32_t)begin);
+            auto hi=std::lower_bound(lo,list -> end(),(std::uint32_t)end);
+            while(hi != lo && (int)result.size()<limit)
+            {
+                --hi;
+                if(matches(*hi))
+                    result.push_back(base+*hi);
+            }
+        }
+        else
+            for(std::int64_t id=end-1;id >= begin && (int)result.size()<limit;id--)
+                if(matches((std::uint32_t)id))
+                    result.push_back(base+id);
+
+        return result;
+    }
+};
+
+class SharedHistory // the game history, shared by every process that maps the same file
+{
+public:
+    static constexpr int RECORD_SIZE=64;
+    static constexpr std::uint64_t SEGMENT_RECORDS=1<<14;
+
+    struct Counters
+    {
+        std::int64_t games[3]{}; // by GameMode
+        std::int64_t wins[3]{};
+        double points{0};        // of the point games
+    };
+
+private:
+    fs::path path;
+    MappedFile file;
+    std::vector<std::unique_ptr<MappedFile> > segments;
+
+    std::uint64_t visible{0}; // committed records seen by this process
+    std::uint64_t unmapped{0};// segments before this one are released
+    std::uint64_t holeSlot=std::numeric_limits<std::uint64_t>::max();
+    std::chrono::steady_clock::time_point holeSince;
+
+    // file layout:
+    //   path: the header, its tail and counters are only changed with atomics
+    //   path.segNNNNNN: SEGMENT_RECORDS fixed-size records, little-endian
+    // a writer reserves a slot by moving the tail, fills it, then sets
+    // COMMITTED in its flags byte, so processes never wait for each other;
+    // the segments before the first record were compacted and deleted
+    static constexpr const char* MAGIC="CWST";
+    static constexpr int VERSION    =2;
+    static constexpr int HEADER_SIZE=128;
+    static constexpr std::uint32_t ORDER_MARK=0x01020304;
+
+    static constexpr int FLAGS_OFFSET=30;
+    static constexpr std::uint8_t COMMITTED=0x80;
+    static constexpr std::uint8_t ABANDONED=0x40; // its writer died before committing
+    static constexpr std::chrono::seconds ABANDON_AFTER{5};
+    static constexpr int APPEND_ATTEMPTS=3;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint32_t recordSize;
+        std::uint32_t byteOrder;
+        std::uint32_t segmentRecords;
+        std::atomic<std::uint64_t> tail; // slots reserved so far
+        std::atomic<std::int64_t> games[3];
+        std::atomic<std::int64_t> wins[3];
+        std::atomic<std::uint64_t> points; // bits of a double
+        std::atomic<std::uint64_t> first;  // the older records were compacted
+    };
+
+    static_assert(sizeof(Header) <= HEADER_SIZE,"header too large");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::uint8_t>::is_always_lock_free,"shared memory needs lock-free atomics");
+
+    Header* header()
+    {
+        return (Header*)file.get();
+    }
+
+    static std::atomic<std::uint8_t>& flagsOf(char* slot)
+    {
+        return *(std::atomic<std::uint8_t>*)(slot+FLAGS_OFFSET);
+    }
+
+    // only for replacing the files, never held while appending; a lock of its own,
+    // so callers may already hold theirs
+    fs::path lockPath()
+    {
+        return path.string()+".history.lock";
+    }
+
+    std::string segmentPath(std::uint64_t segment)
+    {
+        std::string number=std::to_string(segment);
+        return path.string()+".seg"+std::string(6-std::min<std::size_t>(6,number.size()),'0')+number;
+    }
+
+    // segments are created at their full size, so creating one twice is harmless
+    char* slotAt(std::uint64_t i)
+    {
+        std::uint64_t segment=i/SEGMENT_RECORDS;
+        if(segment >= segments.size())
+            segments.resize(segment+1);
+
+        if(!segments[segment])
+            segments[segment]=std::make_unique<MappedFile>(segmentPath(segment),SEGMENT_RECORDS*RECORD_SIZE);
+
+        return segments[segment] -> get()+(i%SEGMENT_RECORDS)*RECORD_SIZE;
+    }
+
+    static bool write(char* slot,const GameRecord& record)
+    {
+        char buf[RECORD_SIZE];
+        encodeRecord(record,buf);
+
+        std::memcpy(slot,buf,FLAGS_OFFSET);
+        std::memcpy(slot+FLAGS_OFFSET+1,buf+FLAGS_OFFSET+1,RECORD_SIZE-FLAGS_OFFSET-1);
+
+        // fails only when a reader gave the slot up
+        std::uint8_t expected=0;
+        return flagsOf(slot).compare_exchange_strong(expected,(std::uint8_t)(buf[FLAGS_OFFSET]|COMMITTED),
+                                                     std::memory_order_release);
+    }
+
+    static void initialize(Header* h,std::uint64_t tail,const Counters& counters)
+    {
+        std::memset((char*)h,0,HEADER_SIZE);
+
+        std::memcpy(h -> magic,MAGIC,4);
+        h -> version=VERSION;
+        h -> headerSize=HEADER_SIZE;
+        h -> recordSize=RECORD_SIZE;
+        h -> byteOrder=ORDER_MARK;
+        h -> segmentRecords=(std::uint32_t)SEGMENT_RECORDS;
+
+        h -> tail.store(tail);
+        for(int m=0;m<3;m++)
+        {
+            h -> games[m].store(counters.games[m]);
+            h -> wins[m].store(counters.wins[m]);
+        }
+
+        std::uint64_t bits;
+        std::memcpy(&bits,&counters.points,sizeof(bits));
+        h -> points.store(bits);
+    }
+
+    void addPoints(double points)
+    {
+        std::uint64_t old=header() -> points.load();
+        while(true)
+        {
+            double value;
+            std::memcpy(&value,&old,sizeof(value));
+            value += points;
+
+            std::uint64_t bits;
+            std::memcpy(&bits,&value,sizeof(bits));
+            if(header() -> points.compare_exchange_weak(old,bits))
+                return;
+        }
+    }
+
+    // with the lock of the history held
+    void replace(const std::vector<GameRecord>& records,const Counters& counters)
+    {
+        file.close();
+        segments.clear();
+        visible=0;
+        unmapped=0;
+
+        for(std::uint64_t segment=0;fs::exists(segmentPath(segment));segment++)
+            fs::remove(segmentPath(segment));
+
+        for(std::uint64_t i=0;i<records.size();i++)
+            write(slotAt(i),records[i]);
+
+        for(auto& segment:segments)
+            segment -> sync();
+
+        auto temp=path.string()+".tmp";
+        fs::remove(temp);
+        {
+            MappedFile headerFile(temp,HEADER_SIZE);
+            initialize((Header*)headerFile.get(),records.size(),counters);
+            headerFile.sync();
+        }
+
+        fs::rename(temp,path);
+        open(path);
+    }
+
+public:
+    SharedHistory(){};
+
+    // the version of the file at path, -1 if there is none, 0 for the old text format
+    static int version(const fs::path& filePath)
+    {
+        if(!fs::exists(filePath) || fs::file_size(filePath) == 0)
+            return -1;
+
+        std::ifstream fin(filePath,std::ios::binary);
+        char buf[8]{};
+        fin.read(buf,8);
+
+        if(fin.gcount()<8 || std::memcmp(buf,MAGIC,4) != 0)
+            return 0;
+
+        return (int)LittleEndian::get(buf+4,4);
+    }
+
+    static void encodeRecord(const GameRecord& record,char* buf)
+    {
+        std::memset(buf,0,RECORD_SIZE);
+
+        LittleEndian::put(buf,record.time,8);
+        LittleEndian::putDouble(buf+8,record.points);
+        LittleEndian::put(buf+16,(std::uint32_t)record.guesses,4);
+        LittleEndian::put(buf+20,(std::uint32_t)record.seconds,4);
+        LittleEndian::put(buf+24,(std::uint32_t)record.limit,4);
+        buf[28]=(char)record.mode;
+        buf[29]=(char)record.result;
+        buf[FLAGS_OFFSET]=(char)record.flags;
+        buf[31]=(char)record.pidLen;
+        std::memcpy(buf+32,record.pid,record.pidLen);
+    }
+
+    static GameRecord decodeRecord(const char* buf)
+    {
+        GameRecord record;
+
+        record.time   =(std::int64_t)LittleEndian::get(buf,8);
+        record.points =LittleEndian::getDouble(buf+8);
+        record.guesses=(std::int32_t)LittleEndian::get(buf+16,4);
+        record.seconds=(std::int32_t)LittleEndian::get(buf+20,4);
+        record.limit  =(std::int32_t)LittleEndian::get(buf+24,4);
+        record.mode   =(GameMode)buf[28];
+        record.result =(std::uint8_t)buf[29];
+        record.flags  =(std::uint8_t)(buf[FLAGS_OFFSET]&~(COMMITTED|ABANDONED));
+        record.pidLen =(std::uint8_t)std::min((int)(std::uint8_t)buf[31],GameRecord::PID_SIZE);
+        std::memcpy(record.pid,buf+32,record.pidLen);
+
+        return record;
+    }
+
+    void open(const fs::path& filePath)
+    {
+        path=filePath;
+        segments.clear();
+        visible=0;
+        unmapped=0;
+
+        if(!fs::exists(path))
+        {
+            // another process may be creating it at the same time
+            FileLock fileLock(lockPath());
+            if(!fs::exists(path))
+            {
+                replace({},Counters());
+                return;
+            }
+        }
+
+        file.open(path,0);
+
+        Header* h=header();
+        if(file.size()<HEADER_SIZE || std::memcmp(h -> magic,MAGIC,4) != 0)
+            throw AppException("Corrupted statistics file: "+path.string());
+
+        if(h -> version>VERSION)
+            throw AppException("Unsupported statistics version: "+path.string());
+
+        if(h -> version != VERSION || h -> headerSize != HEADER_SIZE || h -> recordSize != RECORD_SIZE ||
+           h -> byteOrder != ORDER_MARK || h -> segmentRecords != SEGMENT_RECORDS)
+            throw AppException("Corrupted statistics file: "+path.string());
+
+        visible=h -> first.load();
+    }
+
+    // replace the history with records, the header is swapped in last so a
+    // crash leaves the old file in place; only while no other process uses it
+    void rebuild(const fs::path& filePath,const std::vector<GameRecord>& records,const Counters& counters)
+    {
+        path=filePath;
+
+        FileLock fileLock(lockPath());
+        replace(records,counters);
+    }
+
+    // lock-free; a record whose slot was given up by a reader is written again to a new one
+    bool append(const GameRecord& record)
+    {
+        for(int attempt=1;;attempt++)
+        {
+            std::uint64_t slot=header() -> tail.fetch_add(1);
+            if(write(slotAt(slot),record))
+                break;
+
+            if(attempt == APPEND_ATTEMPTS)
+            {
+                std::cerr << "Game record lost, its slots were given up: " << path.string() << '\n';
+                return false;
+            }
+
+            std::cerr << "Slot " << slot << " was given up, writing the game record again: " << path.string() << '\n';
+        }
+
+        int m=(int)record.mode%3;
+        header() -> games[m].fetch_add(1);
+        header() -> wins[m].fetch_add(record.result);
+
+        if(record.mode == GameMode::Point)
+            addPoints(record.points);
+
+        return true;
+    }
+
+    std::uint64_t reserved()
+    {
+        return header() -> tail.load();
+    }
+
+    // the id of the oldest record still in the history
+    std::uint64_t firstRecord()
+    {
+        return header() -> first.load();
+    }
+
+    // the number of records before the first one still being written
+    std::uint64_t committed()
+    {
+        std::uint64_t first=header() -> first.load();
+        visible=std::max(visible,first);
+
+        // another process may have compacted, the deleted segments stay mapped until now
+        for(;unmapped<first/SEGMENT_RECORDS;unmapped++)
+            if(unmapped<segments.size())
+                segments[unmapped].reset();
+
+        std::uint64_t tail=header() -> tail.load(std::memory_order_acquire);
+        while(visible<tail)
+        {
+            std::atomic<std::uint8_t>& flags=flagsOf(slotAt(visible));
+            if(flags.load(std::memory_order_acquire)&COMMITTED)
+            {
+                visible++;
+                continue;
+            }
+
+            // a writer that died between reserving and committing would hold back
+            // every later record, so its slot is given up after a while
+            auto now=std::chrono::steady_clock::now();
+            if(holeSlot != visible)
+            {
+                holeSlot=visible;
+                holeSince=now;
+            }
+
+            if(now-holeSince<ABANDON_AFTER)
+                break;
+
+            std::uint8_t expected=0;
+            flags.compare_exchange_strong(expected,COMMITTED|ABANDONED);
+        }
+
+        return visible;
+    }
+
+    // i must be below committed(), false for a slot without a game or a compacted one
+    bool read(std::uint64_t i,GameRecord& record)
+    {
+        if(i<header() -> first.load())
+            return false;
+
+        const char* slot=slotAt(i);
+
+        // readers do not hold the file lock: when another process compacted the
+        // segment meanwhile, mapping it created an empty stray file again
+        if(i<header() -> first.load())
+        {
+            segments[i/SEGMENT_RECORDS].reset();
+
+            std::error_code ec;
+            fs::remove(segmentPath(i/SEGMENT_RECORDS),ec);
+            return false;
+        }
+
+        if(flagsOf((char*)slot).load(std::memory_order_acquire)&ABANDONED)
+            return false;
+
+        record=decodeRecord(slot);
+        return true;
+    }
+
+    Counters counters()
+    {
+        Counters result;
+        for(int m=0;m<3;m++)
+        {
+            result.games[m]=header() -> games[m].load();
+            result.wins[m]=header() -> wins[m].load();
+        }
+
+        std::uint64_t bits=header() -> points.load();
+        std::memcpy(&result.points,&bits,sizeof(bits));
+
+        return result;
+    }
+
+    // forget the whole segments before first, which the caller rolled up
+    void dropBefore(std::uint64_t first)
+    {
+        std::uint64_t old=header() -> first.load();
+        if(first <= old)
+            return;
+
+        header() -> first.store(first);
+        file.sync();
+
+        committed();
+
+        // a segment still mapped elsewhere can not be deleted on every system,
+        // it is only a stray file then
+        std::error_code ec;
+        for(std::uint64_t segment=old/SEGMENT_RECORDS;segment<first/SEGMENT_RECORDS;segment++)
+            fs::remove(segmentPath(segment),ec);
+    }
+
+    void sync()
+    {
+        file.sync();
+        for(auto& segment:segments)
+            if(segment)
+                segment -> sync();
+    }
+};
+
+class GlobalStatistics // the leaderboards and ratings of every user, each repo merges its new games in when it saves
+{
+private:
+    fs::path root;
+    fs::path lockFile; // built once, every read takes the lock
+    std::mutex mtx;
+    LeaderboardTable leaders;
+    RatingTable ratings;
+
+    const fs::path& lockPath()
+    {
+        return lockFile;
+    }
+
+public:
+    GlobalStatistics(const fs::path& dir):root(dir),lockFile(dir/"Global.lock")
+    {
+        FileLock fileLock(lockPath());
+        leaders.open(root/"Leaderboards.dat");
+        ratings.open(root/"Ratings.dat");
+    }
+
+    GlobalStatistics(const GlobalStatistics&)=delete;
+    GlobalStatistics& operator=(const GlobalStatistics&)=delete;
+
+    void merge(const std::vector<GameRecord>& records,const std::string& user)
+    {
+        FileLock fileLock(lockPath());
+        std::lock_guard<std::mutex> lock(mtx);
+
+        // a crash in the middle of growing leaves a table to start over
+        if(!leaders.refresh())
+            leaders.reset();
+        if(!ratings.refresh())
+            ratings.reset();
+
+        for(auto& record:records)
+        {
+            leaders.add(record,user);
+            ratings.add(record,user);
+        }
+
+        leaders.sync();
+        ratings.sync();
+    }
+
+    // read as the boards are, merges of other processes are not waited for
+    std::vector<LeaderEntry> top(int metric,const std::string& pid="")
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if(!leaders.refresh())
+            return {};
+
+        return leaders.top(metric,pid);
+    }
+
+    RatingEntry rating(int kind,const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if(!ratings.refresh())
+            return RatingTable::unrated(kind,name);
+
+        return ratings.get(kind,name);
+    }
+
+    RatingEntry pickRatings(const std::string& player,const std::vector<std::string>& pids,std::vector<RatingEntry>& snippets)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return ratings.getPick(player,pids,snippets);
+    }
+};
+
+class StatisticsRepo:public StatisticsSink
+{
+private:
+    fs::path path;
+    fs::path lockFile;
+
+    std::shared_ptr<StatisticsWriter> writer;
+    std::mutex mtx; // the writer thread applies and saves while the UI reads
+
+    SharedHistory history;           // games of every process using the file
+
+    SnippetStatsTable snippetStats;  // per-pid aggregates of the history
+    SketchStore sketches;            // quantile sketches per mode and per pid
+    LeaderboardTable leaders;        // the best games of this history, overall and per pid
+    RatingTable ratings;             // the player of this history and the snippets it played
+
+    std::string owner;               // the user of a StatisticsStore, empty for the local one
+    std::shared_ptr<GlobalStatistics> globalStats;
+    std::vector<GameRecord> unmerged;// games not merged into the global boards yet
+
+    HistoryIndex historyIndex;       // built on the first query, then kept up to date
+    bool indexLoaded=false;
+
+    std::atomic<bool> catchUpRequested{false};
+    static constexpr std::uint64_t CATCH_UP_BATCH=1024; // records per hold of mtx
+    DailyRollupTable daily;          // per-day totals of the compacted history
+
+    // only the newest segments keep every game, the older ones are rolled up
+    // into the daily totals and a snapshot of the per-pid aggregates, so
+    // memory and load time do not grow with the age of the history
+    static constexpr std::uint64_t RETAINED_SEGMENTS=8;
+    static constexpr const char* ROLLUP_TABLES[]={"snippets","sketches","leaders","ratings"};
+
+    // the single-process file before the shared history: a header with the
+    // counters, then the records in the same layout as SharedHistory
+    static constexpr int V1_HEADER_SIZE=96;
+
+    // the aggregate files are shared too, they are caught up under this lock
+    const fs::path& lockPath()
+    {
+        return lockFile;
+    }
+
+    // the snapshot of the aggregates taken by the last compaction,
+    // the generation file names the current one
+    fs::path rollupPath(std::uint64_t generation,const std::string& table)
+    {
+        return path.string()+".rollup"+std::to_string(generation)+"."+table;
+    }
+
+    std::uint64_t rollupGeneration()
+    {
+        std::uint64_t generation=0;
+        std::ifstream fin(path.string()+".rollup");
+        fin >> generation;
+
+        return generation;
+    }
+
+    void updateIndex()
+    {
+        std::uint64_t committed=history.committed();
+
+        // compaction dropped indexed records
+        if(!indexLoaded || historyIndex.first()<(std::int64_t)history.firstRecord())
+        {
+            historyIndex.clear(history.firstRecord());
+            indexLoaded=true;
+        }
+
+        for(std::uint64_t i=historyIndex.end();i<committed;i++)
+        {
+            GameRecord record;
+            if(history.read(i,record))
+                historyIndex.add(record);
+            else
+                historyIndex.addHole();
+        }
+    }
+
+    // parse a history line of the old text format, for example
+    // "Tue May 13 17:21:15 2025  Limited Guesses   P1000  guesses: 5/30 Win"
+    static bool parseLegacyLine(const std::string& line,GameRecord& record)
+    {
+        int infoStart=GameHistoryFormatter::timeWidth+GameHistoryFormatter::gameTypeWidth;
+        if((int)line.size() <= infoStart)
+            return false;
+
+        std::tm tm{};
+        std::istringstream timeStream(line.substr(0,GameHistoryFormatter::timeWidth));
+        timeStream >> std::get_time(&tm,"%a %b %d %H:%M:%S %Y");
+        if(timeStream.fail())
+            return false;
+
+        tm.tm_isdst=-1;
+        record.time=(std::int64_t)std::mktime(&tm);
+
+        std::string gameType=line.substr(GameHistoryFormatter::timeWidth,GameHistoryFormatter::gameTypeWidth);
+        std::string rest=line.substr(infoStart);
+
+        std::size_t info=std::string::npos;
+        for(const char* key:{"guesses: ","time: ","points: "})
+            info=std::min(info,rest.find(key));
+
+        if(info == std::string::npos)
+            return false;
+
+        std::string pid=rest.substr(0,info);
+        pid.erase(pid.find_last_not_of(' ')+1);
+        record.setPid(pid);
+        record.result=rest.find("Win",info) != std::string::npos ?1:0;
+
+        std::string values=rest.substr(rest.find(' ',info)+1);
+        if(gameType.rfind("Limited Guesses",0) == 0)
+        {
+            record.mode=GameMode::GuessLimited;
+            return std::sscanf(values.c_str(),"%d/%d",&record.guesses,&record.limit) == 2;
+        }
+
+        if(gameType.rfind("Time Attack",0) == 0)
+        {
+            record.mode=GameMode::TimeAttack;
+            return std::sscanf(values.c_str(),"%ds/%ds",&record.seconds,&record.limit) == 2;
+        }
+
+        if(gameType.rfind("Point",0) == 0)
+        {
+            record.mode=GameMode::Point;
+            return std::sscanf(values.c_str(),"%lf",&record.points) == 1;
+        }
+
+        return false;
+    }
+
+    void loadLegacy()
+    {
+        // the old format: native ints and a double, then formatted history lines
+        std::ifstream fin(path,std::ios::binary);
+        if(!fin)
+            throw AppException("Could not open file: "+path.string());
+
+        int totalGames=0;
+        int games[3]{};
+        int wins[2]{};
+        SharedHistory::Counters counters;
+
+        fin.read((char*)&totalGames,sizeof(totalGames));
+        fin.read((char*)games,sizeof(games));
+        fin.read((char*)wins,sizeof(wins));
+        fin.read((char*)&counters.points,sizeof(counters.points));
+
+        for(int m=0;m<3;m++)
+            counters.games[m]=games[m];
+        for(int m=0;m<2;m++)
+            counters.wins[m]=wins[m];
+
+        std::vector<GameRecord> records;
+        std::string line;
+        while(std::getline(fin,line))
+        {
+            GameRecord record;
+            if(parseLegacyLine(line,record))
+                records.push_back(record);
+        }
+
+        fin.close();
+
+        // keep the old file, then convert it
+        fs::copy_file(path,path.string()+".legacy",fs::copy_options::overwrite_existing);
+
+        history.rebuild(path,records,counters);
+    }
+
+    void loadVersion1()
+    {
+        std::ifstream fin(path,std::ios::binary);
+        if(!fin)
+            throw AppException("Could not open file: "+path.string());
+
+        char header[V1_HEADER_SIZE]{};
+        fin.read(header,V1_HEADER_SIZE);
+
+        if(LittleEndian::get(header+8,4) != V1_HEADER_SIZE ||
+           LittleEndian::get(header+12,4) != SharedHistory::RECORD_SIZE)
+            throw AppException("Corrupted statistics file: "+path.string());
+
+        std::int64_t count=(std::int64_t)LittleEndian::get(header+16,8);
+
+        SharedHistory::Counters counters;
+        for(int m=0;m<3;m++)
+            counters.games[m]=(std::int64_t)LittleEndian::get(header+32+m*8,8);
+        for(int m=0;m<2;m++)
+            counters.wins[m]=(std::int64_t)LittleEndian::get(header+56+m*8,8);
+        counters.points=LittleEndian::getDouble(header+72);
+
+        // a torn append may leave the count ahead of the records on disk
+        std::vector<GameRecord> records;
+        char buf[SharedHistory::RECORD_SIZE];
+        while((std::int64_t)records.size()<count && fin.read(buf,SharedHistory::RECORD_SIZE))
+            records.push_back(SharedHistory::decodeRecord(buf));
+
+        fin.close();
+
+        // the records keep their ids, so the aggregate files stay valid
+        fs::copy_file(path,path.string()+".v1",fs::copy_options::overwrite_existing);
+
+        history.rebuild(path,records,counters);
+    }
+
+    // with the file lock held
+    void loadFile()
+    {
+        int version=SharedHistory::version(path);
+        if(version == 0)
+            loadLegacy();
+        else
+            if(version == 1)
+                loadVersion1();
+            else
+                history.open(path);
+
+        indexLoaded=false;
+
+        loadSnippetStats();
+    }
+
+    void addAggregates(const GameRecord& record)
+    {
+        SnippetAggregate* slot=snippetStats.add(record);
+        if(!slot -> sketchBlock)
+            slot -> sketchBlock=sketches.allocate();
+
+        sketches.add(record,slot -> sketchBlock);
+        leaders.add(record);
+        ratings.add(record,owner);
+    }
+
+    void loadSnippetStats()
+    {
+        snippetStats.open(path.string()+".snippets");
+        sketches.open(path.string()+".sketches");
+        leaders.open(path.string()+".leaders");
+        ratings.open(path.string()+".ratings");
+        daily.open(path.string()+".daily");
+
+        catchUp();
+    }
+
+    // a table of the last rollup; a rollup taken before the table existed has
+    // none, then only the games after it count for the table
+    template<typename Table>
+    void restoreTable(Table& table,const char* name,std::uint64_t generation,std::uint64_t applied)
+    {
+        Table rolled;
+        rolled.open(rollupPath(generation,name));
+
+        if(rolled.appliedRecords() == applied)
+            table.copyFrom(rolled);
+        else
+        {
+            std::cerr << "Rolled up " << name << " lost: " << path.string() << '\n';
+            table.setAppliedRecords(applied);
+        }
+    }
+
+    // rebuild the aggregates from the last rollup, the history after it is
+    // replayed by catchUp
+    void restoreAggregates()
+    {
+        std::uint64_t first=history.firstRecord();
+        std::uint64_t generation=rollupGeneration();
+
+        snippetStats.reset();
+        sketches.reset();
+        leaders.reset();
+        ratings.reset();
+
+        if(generation == 0)
+            return;
+
+        // the snippets refer to their sketch blocks, so those two come back together
+        SnippetStatsTable rolledSnippets;
+        SketchStore rolledSketches;
+        rolledSnippets.open(rollupPath(generation,"snippets"));
+        rolledSketches.open(rollupPath(generation,"sketches"));
+
+        std::uint64_t applied=rolledSnippets.appliedRecords();
+        if(rolledSketches.appliedRecords() == applied && applied >= first)
+        {
+            snippetStats.copyFrom(rolledSnippets);
+            sketches.copyFrom(rolledSketches);
+            restoreTable(leaders,"leaders",generation,applied);
+            restoreTable(ratings,"ratings",generation,applied);
+        }
+        else
+        {
+            // only the totals in the header survive both files being lost
+            std::cerr << "Rolled up statistics lost: " << path.string() << '\n';
+            snippetStats.setAppliedRecords(first);
+            sketches.setAppliedRecords(first);
+            leaders.setAppliedRecords(first);
+            ratings.setAppliedRecords(first);
+        }
+    }
+
+    // fold at most limit records committed by any process into the aggregates,
+    // with the file lock held; true once they are caught up
+    bool catchUp(std::uint64_t limit=std::numeric_limits<std::uint64_t>::max())
+    {
+        bool valid=snippetStats.refresh();
+        valid=sketches.refresh() && valid;
+        valid=leaders.refresh() && valid;
+        valid=ratings.refresh() && valid;
+
+        std::uint64_t committed=history.committed();
+
+        // the aggregates are ahead of the history after a crash between the writes,
+        // or behind the compacted records when they had to be created again, or
+        // a crash in the middle of growing left a table without its version
+        if(!valid || snippetStats.appliedRecords()>history.reserved() ||
+           sketches.appliedRecords() != snippetStats.appliedRecords() ||
+           leaders.appliedRecords() != snippetStats.appliedRecords() ||
+           ratings.appliedRecords() != snippetStats.appliedRecords() ||
+           snippetStats.appliedRecords()<history.firstRecord())
+            restoreAggregates();
+
+        // a missing table is rebuilt completely
+        std::uint64_t first=snippetStats.appliedRecords();
+        std::uint64_t end=committed-first>limit ?first+limit:committed;
+        for(std::uint64_t i=first;i<end;i++)
+        {
+            GameRecord record;
+            if(history.read(i,record))
+                addAggregates(record);
+            else
+            {
+                snippetStats.skip();
+                sketches.skip();
+                leaders.skip();
+                ratings.skip();
+            }
+        }
+
+        return end == committed;
+    }
+
+    // readers never catch up themselves, they ask the writer thread to do it
+    void requestCatchUp()
+    {
+        if(!catchUpRequested.exchange(true) && !writer -> requestSave(this))
+            catchUpRequested.store(false);
+    }
+
+    // roll the segments older than the retained ones up and delete them,
+    // with the file lock held; the totals in the header are never touched
+    void compact()
+    {
+        std::uint64_t committed=history.committed();
+        std::uint64_t retained=RETAINED_SEGMENTS*SharedHistory::SEGMENT_RECORDS;
+        if(committed<retained)
+            return;
+
+        std::uint64_t keepFrom=(committed-retained)/SharedHistory::SEGMENT_RECORDS*SharedHistory::SEGMENT_RECORDS;
+        if(keepFrom <= history.firstRecord())
+            return;
+
+        // snapshot the aggregates, they cover every record up to committed;
+        // the generation file is switched last, so a crash keeps the old snapshot
+        catchUp();
+        snippetStats.sync();
+        sketches.sync();
+        leaders.sync();
+        ratings.sync();
+
+        std::uint64_t generation=rollupGeneration();
+        for(const char* table:ROLLUP_TABLES)
+            fs::copy_file(path.string()+"."+table,rollupPath(generation+1,table),fs::copy_options::overwrite_existing);
+
+        {
+            std::ofstream fout(path.string()+".rollup.tmp");
+            fout << generation+1;
+        }
+        fs::rename(path.string()+".rollup.tmp",path.string()+".rollup");
+
+        std::error_code ec;
+        for(const char* table:ROLLUP_TABLES)
+            fs::remove(rollupPath(generation,table),ec);
+
+        // the daily totals get exactly the records that are dropped
+        daily.refresh();
+        if(daily.appliedRecords()<history.firstRecord())
+            daily.setAppliedRecords(history.firstRecord());
+
+        for(std::uint64_t i=daily.appliedRecords();i<keepFrom;i++)
+        {
+            GameRecord record;
+            if(history.read(i,record))
+                daily.add(record);
+            else
+                daily.skip();
+        }
+
+        daily.sync();
+        history.dropBefore(keepFrom);
+    }
+
+    static std::string percentiles(const QuantileSketch& sketch)
+    {
+        return std::to_string((int)std::lround(sketch.quantile(0.5)))+"/"+
+               std::to_string((int)std::lround(sketch.quantile(0.9)))+"/"+
+               std::to_string((int)std::lround(sketch.quantile(0.99)));
+    }
+
+    // called by the writer thread
+    void apply(const GameRecord& record) override
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(history.append(record) && globalStats)
+            unmerged.push_back(record);
+    }
+
+    void persist() override
+    {
+        catchUpRequested.store(false);
+        saveToFile();
+    }
+
+public:
+    // games are saved by a writer thread, which can be shared by several repos;
+    // any number of processes can use the same file at once; the games of a
+    // user also go to the global leaderboards and ratings
+    StatisticsRepo(const fs::path& filePath,std::shared_ptr<StatisticsWriter> sharedWriter=nullptr,
+                   const std::string& user="",std::shared_ptr<GlobalStatistics> global=nullptr)
+                  :path(filePath),lockFile(filePath.string()+".lock"),writer(std::move(sharedWriter)),owner(user),globalStats(std::move(global))
+    {
+        if(!writer)
+            writer=std::make_shared<StatisticsWriter>();
+
+        FileLock fileLock(lockPath());
+        loadFile();
+        compact();
+    };
+
+    StatisticsRepo(const StatisticsRepo&)=delete;
+    StatisticsRepo& operator=(const StatisticsRepo&)=delete;
+
+    ~StatisticsRepo()
+    {
+        // the queued games of this repo must be saved before it goes away
+        writer -> drain();
+    }
+
+    void loadFromFile()
+    {
+        FileLock fileLock(lockPath());
+        std::lock_guard<std::mutex> lock(mtx);
+        loadFile();
+    }
+
+    // the games are already in the shared history, this updates the aggregates,
+    // writes the mapped pages back and compacts; the writer thread calls it,
+    // so one background thread serves every repo sharing the writer
+    void saveToFile()
+    {
+        std::vector<GameRecord> merging;
+        {
+            FileLock fileLock(lockPath());
+
+            // in batches, so the readers of this process only wait for one
+            while(true)
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if(catchUp(CATCH_UP_BATCH))
+                    break;
+            }
+
+            std::lock_guard<std::mutex> lock(mtx);
+
+            history.sync();
+            snippetStats.sync();
+            sketches.sync();
+            leaders.sync();
+            ratings.sync();
+
+            compact();
+
+            merging.swap(unmerged);
+        }
+
+        // the global statistics have their own lock, never taken with the one of a user
+        if(globalStats && !merging.empty())
+            globalStats -> merge(merging,owner);
+    }
+
+    // wait until every game added so far is applied and saved
+    void flush()
+    {
+        writer -> drain();
+    }
+
+    // only queues the game, it never blocks on disk
+    void addGame(const GameRecord& record)
+    {
+        writer -> push(this,record);
+    }
+
+    // the readers never wait for the writer, a game shows up once it was applied
+    std::vector<std::string> getStatistics()
+    {
+        requestCatchUp();
+        RatingEntry rating=getPlayerRating();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        bool sketchesValid=sketches.refresh();
+
+        // the counters of every process, read without a lock
+        SharedHistory::Counters c=history.counters();
+        std::int64_t guessLimitedGames=c.games[(int)GameMode::GuessLimited];
+        std::int64_t timeAttackGames  =c.games[(int)GameMode::TimeAttack];
+        std::int64_t pointGames       =c.games[(int)GameMode::Point];
+
+        std::vector<std::string> result;
+
+        result.push_back("Total Games: "+std::to_string(guessLimitedGames+timeAttackGames+pointGames));
+        result.push_back("Guess Limited Games: "+std::to_string(c.wins[(int)GameMode::GuessLimited])
+                        +'/'+std::to_string(guessLimitedGames));
+        result.push_back("Time Attack Games: "+std::to_string(c.wins[(int)GameMode::TimeAttack])
+                        +'/'+std::to_string(timeAttackGames));
+        result.push_back("Point Games: "+std::to_string(pointGames));
+        result.push_back("Average Points: "+std::to_string(pointGames == 0 ?0:c.points/pointGames));
+        result.push_back("Total Points: "+std::to_string(c.points));
+
+        result.push_back("Rating: "+std::to_string((int)std::lround(rating.rating))+
+                         " (+/-"+std::to_string((int)std::lround(2*rating.deviation))+")");
+
+        SketchStore::Block block{};
+        if(sketchesValid && sketches.get((std::uint32_t)GameMode::GuessLimited,block) && guessLimitedGames>0)
+            result.push_back("Limited Guesses p50/p90/p99: "+percentiles(block.metric[SketchStore::GUESSES])+" guesses");
+        if(sketchesValid && sketches.get((std::uint32_t)GameMode::TimeAttack,block) && timeAttackGames>0)
+            result.push_back("Time Attack p50/p90/p99: "+percentiles(block.metric[SketchStore::SECONDS])+" seconds");
+        if(sketchesValid && sketches.get((std::uint32_t)GameMode::Point,block) && pointGames>0)
+            result.push_back("Point p50/p90/p99: "+percentiles(block.metric[SketchStore::POINTS])+" points");
+
+        result.push_back("\n==========Game History==========\n");
+
+        // the history itself is paged, see getHistory
+        return result;
+    }
+
+    // the number of records kept in detail
+    std::int64_t historySize()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return (std::int64_t)(history.committed()-history.firstRecord());
+    }
+
+    // at most count records, the newest first, after skipping the cursor newest ones
+    std::vector<GameRecord> getHistory(std::int64_t cursor,int count)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        std::int64_t end=(std::int64_t)history.committed()-cursor;
+        std::int64_t begin=std::max<std::int64_t>(history.firstRecord(),end-count);
+
+        // In time order, so the last game is at the top
+        std::vector<GameRecord> result;
+        for(std::int64_t i=end-1;i >= begin;i--)
+        {
+            GameRecord record;
+            if(history.read(i,record))
+                result.push_back(record);
+        }
+
+        return result;
+    }
+
+    // O(1) lookup of the aggregates of one snippet
+    bool getSnippetStats(const std::string& pid,SnippetAggregate& result)
+    {
+        requestCatchUp();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return snippetStats.refresh() && snippetStats.find(pid,result);
+    }
+
+    // mode is a GameMode, or the sketchBlock of a SnippetAggregate
+    bool getSketches(std::uint32_t block,SketchStore::Block& result)
+    {
+        requestCatchUp();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return sketches.refresh() && sketches.get(block,result);
+    }
+
+    std::string getSnippetSummary(const std::string& pid)
+    {
+        SnippetAggregate a{};
+        if(!getSnippetStats(pid,a))
+            return "Never played";
+
+        RatingEntry rating=getSnippetRating(pid);
+
+        SketchStore::Block block{};
+        return "Rating: "+std::to_string((int)std::lround(rating.rating))+
+               " (+/-"+std::to_string((int)std::lround(2*rating.deviation))+")"+
+               ", Plays: "+std::to_string(a.plays)+
+               ", Wins: "+std::to_string(a.wins)+
+               ", Guesses: "+std::to_string(a.guesses.mean)+" (var "+std::to_string(a.guesses.variance(a.plays))+")"+
+               ", Time: "+std::to_string(a.seconds.mean)+"s (var "+std::to_string(a.seconds.variance(a.plays))+")"+
+               ", Points: "+std::to_string(a.points.mean)+" (var "+std::to_string(a.points.variance(a.plays))+")"+
+               ", Fuzzy: "+std::to_string(a.fuzzyGames)+
+               ", PID shown: "+std::to_string(a.pidShownGames)+
+               (getSketches(a.sketchBlock,block) ?
+               "\np50/p90/p99 Guesses: "+percentiles(block.metric[SketchStore::GUESSES])+
+               ", Time: "+percentiles(block.metric[SketchStore::SECONDS])+
+               ", Points: "+percentiles(block.metric[SketchStore::POINTS]):"");
+    }
+
+    // kind is RatingTable::PLAYER or SNIPPET; the users of a StatisticsStore
+    // are rated against all players, the local player only by its own games
+    RatingEntry getRating(int kind,const std::string& name)
+    {
+        // the other players are merged in by their own writers, so the
+        // global ratings lag behind anyway and waiting for ours gains little
+        if(globalStats)
+            return globalStats -> rating(kind,name);
+
+        requestCatchUp();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if(!ratings.refresh())
+            return RatingTable::unrated(kind,name);
+
+        return ratings.get(kind,name);
+    }
+
+    RatingEntry getPlayerRating()
+    {
+        return getRating(RatingTable::PLAYER,owner);
+    }
+
+    RatingEntry getSnippetRating(const std::string& pid)
+    {
+        return getRating(RatingTable::SNIPPET,pid);
+    }
+
+    // the player and the candidates of a new game in one read; the queued games
+    // aren't waited for, one game more or less hardly moves a rating
+    RatingEntry getPickRatings(const std::vector<std::string>& pids,std::vector<RatingEntry>& snippets)
+    {
+        if(globalStats)
+            return globalStats -> pickRatings(owner,pids,snippets);
+
+        requestCatchUp();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        return ratings.getPick(owner,pids,snippets);
+    }
+
+    // the best games first, pid empty for the best of all snippets
+    std::vector<LeaderEntry> getLeaderboard(int metric,const std::string& pid="")
+    {
+        requestCatchUp();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if(!leaders.refresh())
+            return {};
+
+        return leaders.top(metric,pid);
+    }
+
+    std::vector<std::string> getLeaderboardLines(const std::string& pid="")
+    {
+        return LeaderboardFormatter::formatAll([&](int metric){return getLeaderboard(metric,pid);});
+    }
+
+    // at most count matching records, the newest first, continuing from query.before;
+    // only the records kept in detail are searched
+    std::vector<GameRecord> query(HistoryQuery& query,int count)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        updateIndex();
+
+        auto ids=historyIndex.find(query,count);
+        if(!ids.empty())
+            query.before=ids.back();
+        else
+            query.before=0;
+
+        std::vector<GameRecord> result(ids.size());
+        for(int i=0;i<(int)ids.size();i++)
+            history.read(ids[i],result[i]);
+
+        return result;
+    }
+
+    // per-day totals of the last days, the oldest first; the rolled up days
+    // and the ones still kept in detail are merged
+    std::vector<DailyAggregate> getDailyStats(int days)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        std::int64_t today=GameRecord::today();
+        std::int64_t fromDay=today-days+1;
+
+        std::map<std::int64_t,DailyAggregate> merged;
+        if(daily.refresh())
+            for(auto& day:daily.get(fromDay,today))
+                merged[day.day]=day;
+
+        std::uint64_t first=std::max(history.firstRecord(),daily.appliedRecords());
+        for(std::uint64_t i=first;i<history.committed();i++)
+        {
+            GameRecord record;
+            if(!history.read(i,record))
+                continue;
+
+            std::int64_t day=GameRecord::dayOf(record.time);
+            if(day<fromDay || day>today)
+                continue;
+
+            auto it=merged.find(day);
+            if(it == merged.end())
+            {
+                DailyAggregate empty{};
+                empty.day=day;
+                it=merged.emplace(day,empty).first;
+            }
+
+            DailyRollupTable::add(it -> second,record);
+        }
+
+        std::vector<DailyAggregate> result;
+        for(auto& entry:merged)
+            result.push_back(entry.second);
+
+        return result;
+    }
+
+    std::vector<std::string> queryLines(HistoryQuery& query,int count)
+    {
+        std::vector<std::string> result;
+        for(auto& record:this -> query(query,count))
+            result.push_back(GameHistoryFormatter::format(record));
+
+        return result;
+    }
+
+    std::vector<std::string> getHistoryLines(std::int64_t cursor,int count)
+    {
+        std::vector<std::string> result;
+        for(auto& record:getHistory(cursor,count))
+            result.push_back(GameHistoryFormatter::format(record));
+
+        return result;
+    }
+};
+
+class StatisticsStore // per-user statistics, each user has a StatisticsRepo in a hashed shard directory
+{
+private:
+    fs::path root;
+    std::size_t capacity;
+
+    // one writer thread saves and compacts for every user
+    std::shared_ptr<StatisticsWriter> writer;
+    std::shared_ptr<GlobalStatistics> global;
+
+    // the first caller loads the repo without the lock, the others wait for its future
+    struct Entry
+    {
+        std::shared_future<std::shared_ptr<StatisticsRepo> > repo;
+        std::list<std::string>::iterator position;
+        std::uint64_t load;
+    };
+
+    std::mutex mtx;
+    std::uint64_t loads=0;
+    std::list<std::string> recent; // the active users, the most recent first
+    std::unordered_map<std::string,Entry> active;
+
+    static void checkUserId(const std::string& userId)
+    {
+        bool valid=!userId.empty() && userId.size() <= 64;
+        for(char c:userId)
+            valid=valid && (std::isalnum((unsigned char)c) || c == '_' || c == '-');
+
+        // the ID becomes a directory name
+        if(!valid)
+            throw AppException("Invalid user ID: "+userId);
+    }
+
+public:
+    // at most maxActive users stay loaded, the others are loaded again on demand
+    StatisticsStore(const fs::path& dir,std::size_t maxActive=256)
+                   :root(dir),capacity(std::max<std::size_t>(1,maxActive)),
+                    writer(std::make_shared<StatisticsWriter>())
+    {
+        fs::create_directories(root);
+        global=std::make_shared<GlobalStatistics>(root);
+    }
+
+    StatisticsStore(const StatisticsStore&)=delete;
+    StatisticsStore& operator=(const StatisticsStore&)=delete;
+
+    ~StatisticsStore()
+    {
+        flush();
+    }
+
+    fs::path userPath(const std::string& userId)
+    {
+        checkUserId(userId);
+
+        static const char hex[]="0123456789abcdef";
+
+        // only used to spread the users over the shard directories
+        auto h=Fnv1a::hash32(userId);
+        std::string level1{hex[(h>>4)&15],hex[h&15]};
+        std::string level2{hex[(h>>12)&15],hex[(h>>8)&15]};
+
+        return root/level1/level2/userId/"Statistics.dat";
+    }
+
+    // the statistics of one user, loaded on first use; the repo stays valid
+    // for its holder even after it is evicted
+    std::shared_ptr<StatisticsRepo> get(const std::string& userId)
+    {
+        fs::path path=userPath(userId);
+
+        std::vector<std::shared_future<std::shared_ptr<StatisticsRepo> > > evicted;
+        std::shared_future<std::shared_ptr<StatisticsRepo> > result;
+        std::promise<std::shared_ptr<StatisticsRepo> > loading;
+        std::uint64_t load=0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            auto it=active.find(userId);
+            if(it != active.end())
+            {
+                recent.splice(recent.begin(),recent,it -> second.position);
+                result=it -> second.repo;
+            }
+            else
+            {
+                load=++loads;
+                result=loading.get_future().share();
+
+                recent.push_front(userId);
+                active[userId]=Entry{result,recent.begin(),load};
+
+                while(active.size()>capacity)
+                {
+                    evicted.push_back(active[recent.back()].repo);
+                    active.erase(recent.back());
+                    recent.pop_back();
+                }
+            }
+        }
+
+        // saving the evicted users must not hold up the others
+        evicted.clear();
+
+        if(load)
+        {
+            try
+            {
+                fs::create_directories(path.parent_path());
+                loading.set_value(std::make_shared<StatisticsRepo>(path,writer,userId,global));
+            }
+            catch(...)
+            {
+                // the waiting callers get the error too, the next one tries again
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+
+                    auto it=active.find(userId);
+                    if(it != active.end() && it -> second.load == load)
+                    {
+                        recent.erase(it -> second.position);
+                        active.erase(it);
+                    }
+                }
+
+                loading.set_exception(std::current_exception());
+            }
+        }
+
+        return result.get();
+    }
+
+    bool exists(const std::string& userId)
+    {
+        return fs::exists(userPath(userId));
+    }
+
+    std::size_t activeUsers()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return active.size();
+    }
+
+    // wait until every game added so far is saved, for all users
+    void flush()
+    {
+        writer -> drain();
+    }
+
+    // the best games of all users, pid empty for the best of all snippets
+    std::vector<LeaderEntry> getLeaderboard(int metric,const std::string& pid="")
+    {
+        return global -> top(metric,pid);
+    }
+
+    std::vector<std::string> getLeaderboardLines(const std::string& pid="")
+    {
+        return LeaderboardFormatter::formatAll([&](int metric){return getLeaderboard(metric,pid);});
+    }
+};
+
+// the replay log of one game: its mode, flags, seed and pid, then every event with the milliseconds since
+// the one before, all in varints. A replay file is MAGIC, then one log after another, each after its length
+struct ReplayLog
+{
+    static constexpr char MAGIC[]="CRPL\x01"; // the last byte is the version
+    static constexpr std::size_t MAGIC_SIZE=5;
+
+    enum Event:std::uint8_t
+    {
+        GUESS =1, // the text given to the snippet
+        REVEAL=2, // how many characters were revealed
+        TOGGLE=3, // 'P' or 'F'
+        END   =4  // the result and the guessed characters, the replay must reach the same
+    };
+
+    template<class String>
+    static void putVarint(String& out,std::uint64_t v)
+    {
+        while(v >= 0x80)
+        {
+            out += (char)(v|0x80);
+            v >>= 7;
+        }
+        out += (char)v;
+    }
+
+    // false if the varint runs past end
+    static bool getVarint(const char*& p,const char* end,std::uint64_t& v)
+    {
+        v=0;
+        for(int shift=0;p<end && shift<64;shift += 7)
+        {
+            std::uint8_t byte=(std::uint8_t)*p++;
+            v |= (std::uint64_t)(byte&0x7f)<<shift;
+            if(!(byte&0x80))
+                return true;
+        }
+
+        return false;
+    }
+};
+
+// a game saved in the middle: MAGIC, the mode, then fixed-size little-endian fields,
+// with the guess state packed in 2 bits a character. See GameCore::save for the layout
+struct GameSnapshot
+{
+    static constexpr char MAGIC[]="CSNP\x02"; // the last byte is the version
+    static constexpr std::size_t MAGIC_SIZE=5;
+
+    static constexpr std::uint8_t FLAG_SNIPPET_FUZZY=0x40; // besides the GameRecord flags
+    static constexpr std::uint8_t FLAG_RECORDING    =0x80;
+
+    struct Writer
+    {
+        std::string& out;
+
+        void put(std::uint64_t v,int bytes)
+        {
+            char buf[8];
+            LittleEndian::put(buf,v,bytes);
+            out.append(buf,bytes);
+        }
+
+        void putDouble(double d)
+        {
+            char buf[8];
+            LittleEndian::putDouble(buf,d);
+            out.append(buf,8);
+        }
+
+        void putBytes(const char* data,std::size_t size)
+        {
+            put(size,4);
+            out.append(data,size);
+        }
+    };
+
+    // past the end every read gives 0 and ok turns false, checked once at the end
+    struct Reader
+    {
+        const char* p;
+        const char* end;
+        bool ok=true;
+
+        bool has(std::size_t size)
+        {
+            if((std::size_t)(end-p)<size)
+                ok=false;
+
+            return ok;
+        }
+
+        std::uint64_t get(int bytes)
+        {
+            if(!has(bytes))
+                return 0;
+
+            std::uint64_t v=LittleEndian::get(p,bytes);
+            p += bytes;
+
+            return v;
+        }
+
+        double getDouble()
+        {
+            if(!has(8))
+                return 0;
+
+            double d=LittleEndian::getDouble(p);
+            p += 8;
+
+            return d;
+        }
+
+        // the bytes stay in the snapshot
+        const char* getBytes(std::size_t& size)
+        {
+            size=get(4);
+            if(!has(size))
+            {
+                size=0;
+                return p;
+            }
+
+            const char* data=p;
+            p += size;
+
+            return data;
+        }
+    };
+
+    static GameMode modeOf(const std::string& data)
+    {
+        if(data.size() <= MAGIC_SIZE || data.compare(0,MAGIC_SIZE,MAGIC,MAGIC_SIZE) != 0 ||
+           (std::uint8_t)data[MAGIC_SIZE]>(std::uint8_t)GameMode::Point)
+            throw AppException("Invalid snapshot");
+
+        return (GameMode)data[MAGIC_SIZE];
+    }
+};
+
+class GameCore // the state every game mode shares: the snippet, the guesses and the clock
+{
+protected:
+    CodeRepo& repo;
+    CodeSnippet snippet;
+
+    StatisticsRepo& stats;
+
+    std::string pid;
+
+    int guesses{0};
+    bool fuzzyAllowed=true;
+    bool showPID=false;
+
+    // every random choice of the game comes from the seed, the same seed replays the same game.
+    // The pick, the reveals and the hints draw from streams of their own, so a replay
+    // needs neither the repo the snippet was picked from nor the auto guesses
+    std::uint64_t seed;
+    GameRng rng;     // the reveals
+    GameRng hintRng; // the auto guesses
+
+    static constexpr std::uint64_t PICK_STREAM=1;
+    static constexpr std::uint64_t HINT_STREAM=2;
+
+    std::chrono::steady_clock::time_point startTime;
+
+    // the daily challenge starts from the shared puzzle instead of picking a snippet
+    std::shared_ptr<const DailyPuzzle> puzzle;
+    bool daily=false;
+
+    // the replay log while recording, from the arena like the snippet state
+    bool recording=false;
+    std::pmr::string replay;
+    std::chrono::steady_clock::time_point lastEventTime;
+
+    void logEvent(ReplayLog::Event type)
+    {
+        auto now=std::chrono::steady_clock::now();
+
+        replay += (char)type;
+        ReplayLog::putVarint(replay,std::chrono::duration_cast<std::chrono::milliseconds>(now-lastEventTime).count());
+        lastEventTime=now;
+    }
+
+    std::uint8_t recordFlags()
+    {
+        return (fuzzyAllowed ?GameRecord::FLAG_FUZZY:0)|(showPID ?GameRecord::FLAG_PID:0)|(daily ?GameRecord::FLAG_DAILY:0);
+    }
+
+    void logStart(GameMode mode)
+    {
+        if(!recording)
+            return;
+
+        replay.clear();
+        replay += (char)mode;
+        replay += (char)recordFlags();
+        ReplayLog::putVarint(replay,seed);
+        ReplayLog::putVarint(replay,pid.size());
+        replay += pid;
+
+        lastEventTime=startTime;
+    }
+
+    void logGuess(const std::string& guess)
+    {
+        if(!recording)
+            return;
+
+        logEvent(ReplayLog::GUESS);
+        ReplayLog::putVarint(replay,guess.size());
+        replay += guess;
+    }
+
+    void logReveal(int count)
+    {
+        if(!recording || count == 0)
+            return;
+
+        logEvent(ReplayLog::REVEAL);
+        ReplayLog::putVarint(replay,count);
+    }
+
+    void logToggle(char option)
+    {
+        if(!recording)
+            return;
+
+        logEvent(ReplayLog::TOGGLE);
+        replay += option;
+    }
+
+    void logEnd(bool isWin)
+    {
+        if(!recording)
+            return;
+
+        logEvent(ReplayLog::END);
+        replay += (char)(isWin ?1:0);
+        ReplayLog::putVarint(replay,snippet.getGuessedNumber());
+    }
+
+    static std::int64_t msSince(std::chrono::steady_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-time).count();
+    }
+
+    static void putRng(GameSnapshot::Writer& out,GameRng& source)
+    {
+        for(auto word:source.getState())
+            out.put(word,8);
+    }
+
+    static void getRng(GameSnapshot::Reader& in,GameRng& target)
+    {
+        std::array<std::uint64_t,4> words;
+        for(auto& word:words)
+            word=in.get(8);
+
+        target.setState(words);
+    }
+
+    // flags, pid, content hash, seed, both generators, guesses, elapsed ms, the packed state,
+    // then the replay log and where its clock is; the times are kept relative to the start
+    void save(GameSnapshot::Writer& out)
+    {
+        out.put(recordFlags()|(snippet.getFuzzyAllowed() ?GameSnapshot::FLAG_SNIPPET_FUZZY:0)|
+                (recording ?GameSnapshot::FLAG_RECORDING:0),1);
+        out.putBytes(pid.data(),pid.size());
+        out.put(snippet.contentHash(),8);
+        out.put(seed,8);
+        putRng(out,rng);
+        putRng(out,hintRng);
+        out.put(guesses,4);
+        out.put(msSince(startTime),8);
+
+        std::size_t sizeAt=out.out.size();
+        out.put(0,4);
+        snippet.packState(out.out);
+        LittleEndian::put(&out.out[sizeAt],out.out.size()-sizeAt-4,4);
+
+        out.putBytes(replay.data(),replay.size());
+        out.put(std::max<std::int64_t>(0,std::chrono::duration_cast<std::chrono::milliseconds>(lastEventTime-startTime).count()),8);
+    }
+
+    void restore(GameSnapshot::Reader& in)
+    {
+        std::uint8_t flags=(std::uint8_t)in.get(1);
+
+        std::size_t size;
+        const char* data=in.getBytes(size);
+        std::string id(data,size);
+
+        std::uint64_t hash=in.get(8);
+        std::uint64_t savedSeed=in.get(8);
+        if(!in.ok)
+            throw AppException("Invalid snapshot");
+
+        // the same pid must still hold the same code, or the state means nothing
+        auto text=repo.loadText(id);
+        if(text -> hash != hash)
+            throw AppException("The snippet "+id+" has changed since the game was saved");
+
+        pid=id;
+        fuzzyAllowed=flags&GameRecord::FLAG_FUZZY;
+        showPID=flags&GameRecord::FLAG_PID;
+        daily=flags&GameRecord::FLAG_DAILY;
+        recording=flags&GameSnapshot::FLAG_RECORDING;
+        snippet.load(text,flags&GameSnapshot::FLAG_SNIPPET_FUZZY);
+
+        setSeed(savedSeed);
+        getRng(in,rng);
+        getRng(in,hintRng);
+        guesses=(int)in.get(4);
+
+        // the clock stood still while the game was saved
+        auto now=std::chrono::steady_clock::now();
+        startTime=now-std::chrono::milliseconds(in.get(8));
+
+        data=in.getBytes(size);
+        if(!in.ok || !snippet.unpackState(data,size))
+            throw AppException("Invalid snapshot");
+
+        data=in.getBytes(size);
+        replay.assign(data,size);
+        lastEventTime=startTime+std::chrono::milliseconds(in.get(8));
+    }
+
+public:
+    // the snippet state comes from arena, SessionManager passes its pool
+    GameCore(CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show,
+             std::pmr::memory_resource* arena=std::pmr::get_default_resource())
+            :repo(repo),snippet(arena),stats(stats),fuzzyAllowed(fuzzy),showPID(show),
+             seed(GameRng::freshSeed()),replay(arena)
+    {
+        setSeed(seed);
+    }
+
+    // before start, to play a recorded game again
+    void setSeed(std::uint64_t value)
+    {
+        seed=value;
+        rng.reseed(value);
+        hintRng=GameRng::stream(value,HINT_STREAM);
+    }
+
+    std::uint64_t getSeed()
+    {
+        return seed;
+    }
+
+    GameRng& random()
+    {
+        return hintRng;
+    }
+
+    // before start, keep a replay log of the game
+    void record(bool enabled)
+    {
+        recording=enabled;
+    }
+
+    // empty unless recording
+    const std::pmr::string& replayLog()
+    {
+        return replay;
+    }
+
+    // before start, play the puzzle of the day instead of a snippet picked for the player
+    void playDaily(std::shared_ptr<const DailyPuzzle> today)
+    {
+        puzzle=std::move(today);
+        daily=true;
+        showPID=false;
+    }
+
+    bool start()
+    {
+        if(daily)
+        {
+            if(!puzzle)
+                return false;
+
+            // the same snippet and the same reveals for everyone, nothing is loaded
+            pid=puzzle -> pid;
+            setSeed(puzzle -> seed);
+            snippet.load(puzzle -> text,fuzzyAllowed);
+        }
+        else
+        {
+            // kept for the next game of this thread
+            static thread_local std::vector<std::string> candidates;
+            static thread_local std::vector<RatingEntry> ratings;
+
+            GameRng pick=GameRng::stream(seed,PICK_STREAM);
+            repo.candidates(pick,candidates);
+            if(candidates.empty())
+                return false;
+
+            double rating=stats.getPickRatings(candidates,ratings).rating;
+
+            // the closest rated candidate: the pick stays random, but leans
+            // towards the snippets the player wins about half of the time
+            int best=0;
+            for(int i=1;i<(int)candidates.size();i++)
+                if(std::abs(ratings[i].rating-rating)<std::abs(ratings[best].rating-rating))
+                    best=i;
+
+            pid=candidates[best];
+
+            snippet.load(repo.loadText(pid),fuzzyAllowed);
+        }
+
+        startTime=std::chrono::steady_clock::now();
+
+        return true;
+    }
+
+    std::string currentId()
+    {
+        return pid;
+    }
+
+    int guessCount()
+    {
+        return guesses;
+    }
+
+    int totalNumber()
+    {
+        return snippet.getTotalNumber();
+    }
+
+    int guessedNumber()
+    {
+        return snippet.getGuessedNumber();
+    }
+
+    bool pidShown()
+    {
+        return showPID;
+    }
+
+    bool fuzzyEnabled()
+    {
+        return fuzzyAllowed;
+    }
+
+    std::chrono::steady_clock::time_point startedAt()
+    {
+        return startTime;
+    }
+
+    std::vector<std::string> getMasked()
+    {
+        return snippet.getMasked();
+    }
+
+    int elapsedSeconds()
+    {
+        auto now=std::chrono::steady_clock::now();
+
+        return (int)std::chrono::duration_cast<std::chrono::seconds>(now-startTime).count();
+    }
+
+    // milliseconds from now until seconds after time, never negative
+    static std::int64_t msUntil(std::chrono::steady_clock::time_point time,int seconds)
+    {
+        auto left=time+std::chrono::seconds(seconds)-std::chrono::steady_clock::now();
+
+        return std::max<std::int64_t>(0,std::chrono::duration_cast<std::chrono::milliseconds>(left).count());
+    }
+
+    // the common part of the statistics record, the game modes fill in the rest
+    GameRecord makeRecord(bool isWin)
+    {
+        GameRecord record;
+
+        auto now=std::chrono::system_clock::now();
+        record.time=std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+
+        record.setPid(pid);
+        record.guesses=guesses;
+        record.seconds=elapsedSeconds();
+        record.result=isWin ?1:0;
+        record.flags=recordFlags();
+
+        return record;
+    }
+};
+
+// reveal policies: how many characters are revealed after a guess, and
+// which reveals fall due with the time alone
+
+template<int Guesses>
+struct RevealEveryGuesses
+{
+    void start(GameCore&){}
+
+    void save(GameSnapshot::Writer&,GameCore&){}
+    void restore(GameSnapshot::Reader&,GameCore&){}
+
+    int times(GameCore& game)
+    {
+        return game.guessCount()%Guesses == 0 ?1:0;
+    }
+
+    int due(GameCore&)
+    {
+        return 0;
+    }
+
+    std::int64_t nextMs(GameCore&)
+    {
+        return -1;
+    }
+};
+
+template<int Seconds>
+struct RevealEverySeconds
+{
+    std::chrono::steady_clock::time_point lastRevealTime;
+
+    void start(GameCore& game)
+    {
+        lastRevealTime=game.startedAt();
+    }
+
+    void save(GameSnapshot::Writer& out,GameCore& game)
+    {
+        out.put(std::chrono::duration_cast<std::chrono::milliseconds>(lastRevealTime-game.startedAt()).count(),8);
+    }
+
+    void restore(GameSnapshot::Reader& in,GameCore& game)
+    {
+        lastRevealTime=game.startedAt()+std::chrono::milliseconds(in.get(8));
+    }
+
+    int times(GameCore&)
+    {
+        auto now=std::chrono::steady_clock::now();
+
+        int result=std::chrono::duration_cast<std::chrono::seconds>(now-lastRevealTime).count()/Seconds;
+        lastRevealTime += std::chrono::seconds(Seconds*result);
+
+        return result;
+    }
+
+    int due(GameCore& game)
+    {
+        return times(game);
+    }
+
+    std::int64_t nextMs(GameCore&)
+    {
+        return GameCore::msUntil(lastRevealTime,Seconds);
+    }
+};
+
+struct NoReveal
+{
+    void start(GameCore&){}
+
+    void save(GameSnapshot::Writer&,GameCore&){}
+    void restore(GameSnapshot::Reader&,GameCore&){}
+
+    int times(GameCore&)
+    {
+        return 0;
+    }
+
+    int due(GameCore&)
+    {
+        return 0;
+    }
+
+    std::int64_t nextMs(GameCore&)
+    {
+        return -1;
+    }
+};
+
+// end conditions: when the game is lost, and what the result message counts
+
+struct GuessLimit // for example, 30 guesses
+{
+    static constexpr GameMode mode=GameMode::GuessLimited;
+
+    int maxGuesses{0};
+
+    void start(GameCore& game)
+    {
+        maxGuesses=std::max(game.totalNumber()/3+5,30); // 30 is the minimum number of guesses
+    }
+
+    void save(GameSnapshot::Writer& out,GameCore&)
+    {
+        out.put(maxGuesses,4);
+    }
+
+    void restore(GameSnapshot::Reader& in,GameCore&)
+    {
+        maxGuesses=(int)in.get(4);
+    }
+
+    bool over(GameCore& game)
+    {
+        return game.guessCount() >= maxGuesses;
+    }
+
+    // only the player ends it
+    std::int64_t remainingMs(GameCore&)
+    {
+        return -1;
+    }
+
+    int limit()
+    {
+        return maxGuesses;
+    }
+
+    std::string info(GameCore& game)
+    {
+        return "Guesses: "+std::to_string(game.guessCount())+"/"+std::to_string(maxGuesses);
+    }
+
+    std::string used(GameCore& game)
+    {
+        return std::to_string(game.guessCount())+" guesses";
+    }
+};
+
+struct TimeLimit // for example, 10min
+{
+    static constexpr GameMode mode=GameMode::TimeAttack;
+
+    int maxTime{0};
+
+    void start(GameCore& game)
+    {
+        maxTime=std::max(1.0*game.totalNumber()/1.5+10,60.0); // 60 is the minimum time in seconds
+    }
+
+    void save(GameSnapshot::Writer& out,GameCore&)
+    {
+        out.put(maxTime,4);
+    }
+
+    void restore(GameSnapshot::Reader& in,GameCore&)
+    {
+        maxTime=(int)in.get(4);
+    }
+
+    bool over(GameCore& game)
+    {
+        return game.elapsedSeconds() >= maxTime;
+    }
+
+    std::int64_t remainingMs(GameCore& game)
+    {
+        return GameCore::msUntil(game.startedAt(),maxTime);
+    }
+
+    int limit()
+    {
+        return maxTime;
+    }
+
+    std::string info(GameCore& game)
+    {
+        return "Time: "+std::to_string(game.elapsedSeconds())+"s/"+std::to_string(maxTime)+"s";
+    }
+
+    std::string used(GameCore& game)
+    {
+        return std::to_string(game.elapsedSeconds())+" seconds";
+    }
+};
+
+struct NoLimit // you can guess forever
+{
+    void start(GameCore&){}
+
+    void save(GameSnapshot::Writer&,GameCore&){}
+    void restore(GameSnapshot::Reader&,GameCore&){}
+
+    bool over(GameCore&)
+    {
+        return false;
+    }
+
+    std::int64_t remainingMs(GameCore&)
+    {
+        return -1;
+    }
+};
+
+// scoring policies: the game info, the result and what goes into the record
+
+struct OutcomeScoring // win or lose against the end condition
+{
+    static constexpr bool canLose=true;
+
+    void save(GameSnapshot::Writer&,GameCore&){}
+    void restore(GameSnapshot::Reader&,GameCore&){}
+
+    template<class End>
+    std::string info(GameCore& game,End& end)
+    {
+        return end.info(game);
+    }
+
+    std::vector<std::string> hints()
+    {
+        return {"Enter your guesses(>= 3 chars), or end the game by entering E, or get an auto guess by entering A"};
+    }
+
+    template<class End>
+    std::string win(GameCore& game,End& end)
+    {
+        return "You win! You only used "+end.used(game)+"!";
+    }
+
+    template<class End>
+    std::string lose(GameCore& game,End& end)
+    {
+        return "You lose. You have used "+end.used(game)+".";
+    }
+
+    template<class End>
+    void fill(GameRecord& record,GameCore&,End& end)
+    {
+        record.mode=End::mode;
+        record.limit=end.limit();
+    }
+};
+
+struct PointScoring // caculate points based on guesses
+{
+    static constexpr bool canLose=false; // a lost game is saved as a win, like its message says
+
+    double points{0};
+
+    double guessPenalty;
+    double pointFactor;
+    double rewardFactor;
+
+    static constexpr double showPidPenalty{0.5};
+    static constexpr double fuzzyPenalty  {0.8};
+
+    PointScoring(double penalty=100,double pfactor=500,double rfactor=1.5)
+    {
+        if(penalty <= 0)
+            throw AppException("Penalty must be positive");
+
+        if(pfactor <= 0)
+            throw AppException("Point factor must be positive");
+
+        if(rfactor<1.0)
+            throw AppException("Reward factor must be not less than 1.0");
+
+        guessPenalty=penalty;
+        pointFactor=pfactor;
+        rewardFactor=rfactor;
+    }
+
+    void save(GameSnapshot::Writer& out,GameCore&)
+    {
+        out.putDouble(guessPenalty);
+        out.putDouble(pointFactor);
+        out.putDouble(rewardFactor);
+    }
+
+    void restore(GameSnapshot::Reader& in,GameCore&)
+    {
+        guessPenalty=in.getDouble();
+        pointFactor=in.getDouble();
+        rewardFactor=in.getDouble();
+    }
+
+    void calcPoint(GameCore& game)
+    {
+        int guessed=game.guessedNumber();
+        int totalNumber=game.totalNumber();
+
+        points=pointFactor*guessed*guessed/totalNumber-
+               guessPenalty*game.guessCount();
+
+        if(game.pidShown())
+            points *= showPidPenalty;
+
+        if(game.fuzzyEnabled())
+            points *= fuzzyPenalty;
+
+        if(guessed == totalNumber)
+            points *= rewardFactor;
+    }
+
+    template<class End>
+    std::string info(GameCore& game,End&)
+    {
+        calcPoint(game);
+
+        return "Points: "+std::to_string(points);
+    }
+
+    std::vector<std::string> hints()
+    {
+        return {"Enter P to show the problem ID, or F to enable fuzzy match",
+                "The game will be easier, but you will get LESS points",
+                "Enter your guesses(>= 3 chars), or end the game by entering E"};
+    }
+
+    template<class End>
+    std::string win(GameCore& game,End&)
+    {
+        calcPoint(game);
+
+        return "You achieved "+std::to_string(points)+" points!";
+    }
+
+    // there's no "Lose" in point mode, even if your points is negative
+    template<class End>
+    std::string lose(GameCore& game,End& end)
+    {
+        return win(game,end);
+    }
+
+    template<class End>
+    void fill(GameRecord& record,GameCore& game,End&)
+    {
+        calcPoint(game);
+
+        record.mode=GameMode::Point;
+        record.points=points;
+    }
+};
+
+// a game mode composed from the policies, every call is resolved at compile time
+template<class Reveal,class End,class Scoring>
+class BasicGame:public GameCore
+{
+private:
+    Reveal reveal;
+    End end;
+    Scoring scoring;
+
+    static constexpr GameMode mode()
+    {
+        if constexpr(Scoring::canLose)
+            return End::mode;
+        else
+            return GameMode::Point;
+    }
+
+public:
+    template<class... ScoringArgs>
+    BasicGame(CodeRepo& repo,StatisticsRepo& stats,bool fuzzy,bool show,
+              std::pmr::memory_resource* arena=std::pmr::get_default_resource(),ScoringArgs&&... args)
+             :GameCore(repo,stats,fuzzy,show,arena),scoring(std::forward<ScoringArgs>(args)...){}
+
+    bool start()
+    {
+        if(!GameCore::start())
+            return false;
+
+        reveal.start(*this);
+        end.start(*this);
+
+        logStart(mode());
+
+        return true;
+    }
+
+    // appends the snapshot to out, which can be reused from one save to the next
+    void snapshot(std::string& out)
+    {
+        out.append(GameSnapshot::MAGIC,GameSnapshot::MAGIC_SIZE);
+        out += (char)mode();
+
+        GameSnapshot::Writer writer{out};
+        save(writer);
+        reveal.save(writer,*this);
+        end.save(writer,*this);
+        scoring.save(writer,*this);
+    }
+
+    // instead of start, goes on with a game saved by snapshot
+    void restore(const std::string& data)
+    {
+        if(GameSnapshot::modeOf(data) != mode())
+            throw AppException("The snapshot is of another mode");
+
+        GameSnapshot::Reader reader{data.data()+GameSnapshot::MAGIC_SIZE+1,data.data()+data.size()};
+        GameCore::restore(reader);
+        reveal.restore(reader,*this);
+        end.restore(reader,*this);
+        scoring.restore(reader,*this);
+
+        if(!reader.ok || reader.p != reader.end)
+            throw AppException("Invalid snapshot");
+    }
+
+    std::vector<std::string> getGameInfo()
+    {
+        return {scoring.info(*this,end)};
+    }
+
+    std::vector<std::string> getDisplayLines()
+    {
+        std::vector<std::string> result=getGameInfo();
+
+        if(showPID)
+            result.push_back("Problem: www.luogu.com.cn/problem/"+pid);
+
+        auto temp=snippet.getMasked();
+        for(auto& line:temp)
+            result.push_back(line);
+
+        for(auto& line:scoring.hints())
+            result.push_back(line);
+
+        return result;
+    }
+
+    std::vector<std::string> makeGuess(const std::string& guess)
+    {
+        // everyone plays the same snippet, its ID would give it away
+        if(daily && guess == "P")
+            return {"The problem ID stays hidden in the daily challenge"};
+
+        if(!showPID && guess == "P")
+        {
+            showPID=true;
+            logToggle('P');
+            return {"PID showing enabled"};
+        }
+
+        if(!fuzzyAllowed && guess == "F")
+        {
+            fuzzyAllowed=true;
+            logToggle('F');
+            return {"Fuzzy match enabled"};
+        }
+
+        auto result=snippet.guess(guess);
+        logGuess(guess);
+
+        // guess is too short
+        if(result[0] == -1)
+            return {"Guess must be at least "+std::to_string(snippet.getMinLen())+" chars"};
+
+        ++guesses;
+
+        int count=reveal.times(*this);
+        logReveal(count);
+        while(count--)
+            snippet.reveal(rng);
+
+        std::string msg=std::to_string(result[0])+" matches found";
+
+        // fuzzy match
+        if(result[1] != -1)
+            msg += ", "+std::to_string(result[1])+" fuzzy matches found";
+
+        msg += '.';
+
+        return {msg};
+    }
+
+    void saveStatistics(bool isWin)
+    {
+        GameRecord record=makeRecord(isWin || !Scoring::canLose);
+        scoring.fill(record,*this,end);
+
+        stats.addGame(record);
+    }
+
+    std::string Win()
+    {
+        logEnd(true);
+        saveStatistics(true);
+
+        return scoring.win(*this,end);
+    }
+
+    std::string Lose()
+    {
+        logEnd(false);
+        saveStatistics(false);
+
+        return scoring.lose(*this,end);
+    }
+
+    bool isFinished()
+    {
+        return snippet.check();
+    }
+
+    bool isOver()
+    {
+        return end.over(*this);
+    }
+
+    // the reveals that fell due while the player was idle, returns how many
+    int advanceClock()
+    {
+        int count=reveal.due(*this);
+        logReveal(count);
+        for(int i=0;i<count;i++)
+            snippet.reveal(rng);
+
+        return count;
+    }
+
+    // until the next reveal or the end of the game, -1 if nothing happens without the player
+    std::int64_t nextEventMs()
+    {
+        std::int64_t revealMs=reveal.nextMs(*this);
+        std::int64_t endMs=end.remainingMs(*this);
+
+        if(revealMs<0 || (endMs >= 0 && endMs<revealMs))
+            return endMs;
+
+        return revealMs;
+    }
+};
+
+using guessLimitedGame=BasicGame<RevealEveryGuesses<5>,GuessLimit,OutcomeScoring>;  // Guess limited game(for example, 30 guesses)
+using timeAttackGame  =BasicGame<RevealEverySeconds<10>,TimeLimit,OutcomeScoring>;  // Time limited game(for example, 10min)
+using pointGame       =BasicGame<NoReveal,NoLimit,PointScoring>;                    // Point game(caculate points based on guesses)
+
+class Game // a game of any mode, std::visit picks the mode once per call
+{
+private:
+    std::variant<guessLimitedGame,timeAttackGame,pointGame> mode;
+
+public:
+    // Game(std::in_place_type<pointGame>,repo,stats,fuzzy,show)
+    template<class T,class... Args>
+    Game(std::in_place_type_t<T> type,Args&&... args):mode(type,std::forward<Args>(args)...){}
+
+    bool start()
+    {
+        return std::visit([](auto& game){return game.start();},mode);
+    }
+
+    void setSeed(std::uint64_t seed)
+    {
+        std::visit([&](auto& game){game.setSeed(seed);},mode);
+    }
+
+    std::uint64_t getSeed()
+    {
+        return std::visit([](auto& game){return game.getSeed();},mode);
+    }
+
+    GameRng& random()
+    {
+        return std::visit([](auto& game) -> GameRng& {return game.random();},mode);
+    }
+
+    void record(bool enabled)
+    {
+        std::visit([&](auto& game){game.record(enabled);},mode);
+    }
+
+    void playDaily(std::shared_ptr<const DailyPuzzle> today)
+    {
+        std::visit([&](auto& game){game.playDaily(std::move(today));},mode);
+    }
+
+    void snapshot(std::string& out)
+    {
+        std::visit([&](auto& game){game.snapshot(out);},mode);
+    }
+
+    void restore(const std::string& data)
+    {
+        std::visit([&](auto& game){game.restore(data);},mode);
+    }
+
+    const std::pmr::string& replayLog()
+    {
+        return std::visit([](auto& game) -> const std::pmr::string& {return game.replayLog();},mode);
+    }
+
+    std::string currentId()
+    {
+        return std::visit([](auto& game){return game.currentId();},mode);
+    }
+
+    int guessCount()
+    {
+        return std::visit([](auto& game){return game.guessCount();},mode);
+    }
+
+    std::vector<std::string> getMasked()
+    {
+        return std::visit([](auto& game){return game.getMasked();},mode);
+    }
+
+    std::vector<std::string> getGameInfo()
+    {
+        return std::visit([](auto& game){return game.getGameInfo();},mode);
+    }
+
+    std::vector<std::string> getDisplayLines()
+    {
+        return std::visit([](auto& game){return game.getDisplayLines();},mode);
+    }
+
+    std::vector<std::string> makeGuess(const std::string& guess)
+    {
+        return std::visit([&](auto& game){return game.makeGuess(guess);},mode);
+    }
+
+    std::string Win()
+    {
+        return std::visit([](auto& game){return game.Win();},mode);
+    }
+
+    std::string Lose()
+    {
+        return std::visit([](auto& game){return game.Lose();},mode);
+    }
+
+    bool isFinished()
+    {
+        return std::visit([](auto& game){return game.isFinished();},mode);
+    }
+
+    bool isOver()
+    {
+        return std::visit([](auto& game){return game.isOver();},mode);
+    }
+
+    int advanceClock()
+    {
+        return std::visit([](auto& game){return game.advanceClock();},mode);
+    }
+
+    std::int64_t nextEventMs()
+    {
+        return std::visit([](auto& game){return game.nextEventMs();},mode);
+    }
+};
+
+class ReplayWriter // appends the logs of finished games to a replay file, from any thread
+{
+private:
+    std::mutex mtx;
+    std::ofstream out;
+    std::string prefix; // the length of a log
+
+public:
+    ReplayWriter(const fs::path& path)
+    {
+        bool fresh=!fs::exists(path) || fs::file_size(path) == 0;
+
+        out.open(path,std::ios::binary|std::ios::app);
+        if(!out)
+            throw AppException("Could not open file: "+path.string());
+
+        if(fresh)
+            out.write(ReplayLog::MAGIC,ReplayLog::MAGIC_SIZE);
+    }
+
+    ReplayWriter(const ReplayWriter&)=delete;
+    ReplayWriter& operator=(const ReplayWriter&)=delete;
+
+    void write(const std::pmr::string& log)
+    {
+        if(log.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        prefix.clear();
+        ReplayLog::putVarint(prefix,log.size());
+
+        out.write(prefix.data(),prefix.size());
+        out.write(log.data(),log.size());
+    }
+};
+
+class Replayer // plays the games of a replay file again against their snippets, on every core
+{
+public:
+    struct Summary
+    {
+        std::uint64_t games   {0};
+        std::uint64_t guesses {0};
+        std::uint64_t reveals {0};
+        std::uint64_t diverged{0}; // ended with other characters guessed than recorded
+        std::uint64_t missing {0}; // the snippet is not in the repo any more
+        std::uint64_t corrupt {0};
+        double seconds{0};
+
+        void add(const Summary& other)
+        {
+            games    += other.games;
+            guesses  += other.guesses;
+            reveals  += other.reveals;
+            diverged += other.diverged;
+            missing  += other.missing;
+            corrupt  += other.corrupt;
+        }
+    };
+
+private:
+    enum class Outcome
+    {
+        Same,
+        Diverged,
+        Missing,
+        Corrupt
+    };
+
+    // what one worker reuses from game to game, so replaying allocates almost nothing
+    struct Context
+    {
+        CodeSnippet snippet;
+        std::string guess;
+        std::unordered_map<std::string,std::shared_ptr<const SnippetText> > texts;
+        Summary summary;
+    };
+
+    CodeRepo& repo;
+
+    std::string data; // the whole file
+    std::vector<std::pair<std::size_t,std::size_t> > logs; // the offset and size of each game
+
+    static constexpr int CHUNKS_PER_THREAD=8;
+
+    // on(type,ms,text,count) is called after each event, text is the guess or the option
+    template<class OnEvent>
+    Outcome play(std::size_t index,Context& context,OnEvent&& on)
+    {
+        const char* p=data.data()+logs[index].first;
+        const char* end=p+logs[index].second;
+
+        if(end-p<2)
+            return Outcome::Corrupt;
+        p++; // the mode
+        std::uint8_t flags=(std::uint8_t)*p++;
+
+        std::uint64_t seed,pidSize;
+        if(!ReplayLog::getVarint(p,end,seed) || !ReplayLog::getVarint(p,end,pidSize) || pidSize>(std::uint64_t)(end-p))
+            return Outcome::Corrupt;
+        std::string pid(p,pidSize);
+        p += pidSize;
+
+        auto& text=context.texts[pid];
+        if(!text)
+        {
+            try
+            {
+                text=repo.loadText(pid);
+            }
+            catch(const AppException&)
+            {
+                context.texts.erase(pid);
+                return Outcome::Missing;
+            }
+        }
+
+        CodeSnippet& snippet=context.snippet;
+        snippet.load(text,flags&GameRecord::FLAG_FUZZY);
+
+        GameRng rng(seed); // the reveal stream, see GameCore
+
+        while(p<end)
+        {
+            auto type=(ReplayLog::Event)*p++;
+
+            std::uint64_t ms,value;
+            if(!ReplayLog::getVarint(p,end,ms))
+                return Outcome::Corrupt;
+
+            switch(type)
+            {
+                case ReplayLog::GUESS:
+                {
+                    if(!ReplayLog::getVarint(p,end,value) || value>(std::uint64_t)(end-p))
+                        return Outcome::Corrupt;
+
+                    context.guess.assign(p,value);
+                    p += value;
+
+                    auto result=snippet.guess(context.guess);
+                    context.summary.guesses++;
+
+                    on(type,ms,context.guess,result[0]);
+                    break;
+                }
+                case ReplayLog::REVEAL:
+                {
+                    if(!ReplayLog::getVarint(p,end,value))
+                        return Outcome::Corrupt;
+
+                    for(std::uint64_t i=0;i<value;i++)
+                        snippet.reveal(rng);
+                    context.summary.reveals += value;
+
+                    on(type,ms,context.guess,(int)value);
+                    break;
+                }
+                case ReplayLog::TOGGLE:
+                {
+                    if(p == end)
+                        return Outcome::Corrupt;
+
+                    context.guess.assign(1,*p++);
+
+                    on(type,ms,context.guess,0);
+                    break;
+                }
+                case ReplayLog::END:
+                {
+                    if(p == end)
+                        return Outcome::Corrupt;
+
+                    bool isWin=*p++ != 0;
+                    if(!ReplayLog::getVarint(p,end,value))
+                        return Outcome::Corrupt;
+
+                    on(type,ms,context.guess,isWin ?1:0);
+
+                    return (std::uint64_t)snippet.getGuessedNumber() == value ?Outcome::Same:Outcome::Diverged;
+                }
+                default:
+                    return Outcome::Corrupt;
+            }
+        }
+
+        // a game dropped before its end, nothing to check it against
+        return Outcome::Same;
+    }
+
+    void count(Outcome outcome,Summary& summary)
+    {
+        summary.games++;
+
+        if(outcome == Outcome::Diverged)
+            summary.diverged++;
+        if(outcome == Outcome::Missing)
+            summary.missing++;
+        if(outcome == Outcome::Corrupt)
+            summary.corrupt++;
+    }
+
+public:
+    Replayer(CodeRepo& repo,const fs::path& path):repo(repo)
+    {
+        std::ifstream fin(path,std::ios::binary);
+        if(!fin)
+            throw AppException("Could not open file: "+path.string());
+
+        data.assign((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+
+        if(data.compare(0,ReplayLog::MAGIC_SIZE,ReplayLog::MAGIC,ReplayLog::MAGIC_SIZE) != 0)
+            throw AppException("Not a replay file: "+path.string());
+
+        // a log cut off by a crash ends the file
+        const char* begin=data.data();
+        const char* p=begin+ReplayLog::MAGIC_SIZE;
+        const char* end=begin+data.size();
+        while(p<end)
+        {
+            std::uint64_t size;
+            if(!ReplayLog::getVarint(p,end,size) || size>(std::uint64_t)(end-p))
+                break;
+
+            logs.emplace_back(p-begin,size);
+            p += size;
+        }
+    }
+
+    std::size_t size()
+    {
+        return logs.size();
+    }
+
+    // replay every game, the games are split into chunks the workers take from each other
+    Summary run(unsigned threads=std::thread::hardware_concurrency())
+    {
+        auto startTime=std::chrono::steady_clock::now();
+
+        Summary total;
+        std::mutex totalMtx;
+        {
+            ThreadPool pool(std::max(1u,threads));
+
+            std::size_t chunks=std::min(logs.size(),(std::size_t)pool.size()*CHUNKS_PER_THREAD);
+            for(std::size_t c=0;c<chunks;c++)
+            {
+                pool.submit([this,c,chunks,&total,&totalMtx]
+                {
+                    Context context;
+
+                    for(std::size_t i=logs.size()*c/chunks;i<logs.size()*(c+1)/chunks;i++)
+                        count(play(i,context,[](ReplayLog::Event,std::uint64_t,const std::string&,int){}),context.summary);
+
+                    std::lock_guard<std::mutex> lock(totalMtx);
+                    total.add(context.summary);
+                });
+            }
+
+            pool.wait();
+        }
+
+        total.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-startTime).count();
+
+        return total;
+    }
+
+    // one game step by step, for looking into a report
+    std::vector<std::string> trace(std::size_t index)
+    {
+        if(index >= logs.size())
+            throw AppException("There's no game "+std::to_string(index)+" in the replay file");
+
+        std::vector<std::string> result;
+
+        const char* p=data.data()+logs[index].first;
+        const char* end=p+logs[index].second;
+        std::uint64_t seed=0,pidSize=0;
+        if(end-p >= 2)
+        {
+            const char* q=p+2;
+            if(ReplayLog::getVarint(q,end,seed) && ReplayLog::getVarint(q,end,pidSize) && pidSize <= (std::uint64_t)(end-q))
+                result.push_back("Mode: "+std::string(1,"GTP"[std::min(2,(int)(std::uint8_t)p[0])])+
+                                 ", Seed: "+std::to_string(seed)+", Problem: "+std::string(q,pidSize));
+        }
+
+        Context context;
+        std::uint64_t elapsed=0;
+        Outcome outcome=play(index,context,[&](ReplayLog::Event type,std::uint64_t ms,const std::string& text,int value)
+        {
+            elapsed += ms;
+
+            std::string line=std::to_string(elapsed)+"ms ";
+            if(type == ReplayLog::GUESS)
+                line += "Guess \""+text+"\": "+(value<0 ?"too short":std::to_string(value)+" matches");
+            if(type == ReplayLog::REVEAL)
+                line += std::to_string(value)+" revealed";
+            if(type == ReplayLog::TOGGLE)
+                line += "Enabled "+text;
+            if(type == ReplayLog::END)
+                line += value ?"Win":"Lose";
+
+            result.push_back(line);
+        });
+
+        if(outcome == Outcome::Missing)
+            result.push_back("The snippet is not in the repo");
+        else if(outcome == Outcome::Corrupt)
+            result.push_back("The log is corrupt");
+        else
+        {
+            for(auto& line:context.snippet.getMasked())
+                result.push_back(line);
+
+            if(outcome == Outcome::Diverged)
+                result.push_back("The replay diverged from the recorded game");
+        }
+
+        return result;
+    }
+};
+
+class SessionManager // the running games in recycled slots, found by session ID in O(1)
+{
+public:
+    using Id=std::uint64_t; // the slot generation in the high half, the slot index in the low half, never 0
+
+private:
+    struct Slot
+    {
+        alignas(Game) unsigned char storage[sizeof(Game)];
+
+        Game* game{nullptr};
+        std::uint32_t generation{1}; // bumped on every release, so old IDs never match again
+    };
+
+    // the snippet states of all games, freed blocks are kept for the next ones;
+    // the pools are per thread, games may run on any worker
+    std::pmr::synchronized_pool_resource arena;
+
+    std::mutex mtx;         // for the slots, a game itself belongs to one thread at a time
+    std::deque<Slot> slots; // grows without moving the games
+    std::vector<std::uint32_t> freeSlots;
+    std::size_t running{0};
+
+    Slot* find(Id id)
+    {
+        std::uint32_t index=(std::uint32_t)id;
+        if(index >= slots.size())
+            return nullptr;
+
+        Slot& slot=slots[index];
+        if(!slot.game || slot.generation != (std::uint32_t)(id>>32))
+            return nullptr;
+
+        return &slot;
+    }
+
+public:
+    SessionManager(){};
+
+    SessionManager(const SessionManager&)=delete;
+    SessionManager& operator=(const SessionManager&)=delete;
+
+    ~SessionManager()
+    {
+        for(auto& slot:slots)
+            if(slot.game)
+                slot.game -> ~Game();
+    }
+
+    // constructs a game of mode T from args...,arena in a free slot
+    template<class T,class... Args>
+    Id create(Args&&... args)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if(freeSlots.empty())
+        {
+            slots.emplace_back();
+            freeSlots.push_back((std::uint32_t)slots.size()-1);
+        }
+
+        std::uint32_t index=freeSlots.back();
+        Slot& slot=slots[index];
+
+        slot.game=new(slot.storage) Game(std::in_place_type<T>,std::forward<Args>(args)...,&arena);
+        freeSlots.pop_back();
+        running++;
+
+        return ((Id)slot.generation<<32)|index;
+    }
+
+    // nullptr for a released or unknown ID
+    Game* get(Id id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Slot* slot=find(id);
+
+        return slot ?slot -> game:nullptr;
+    }
+
+    bool release(Id id)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Slot* slot=find(id);
+        if(!slot)
+            return false;
+
+        slot -> game -> ~Game();
+        slot -> game=nullptr;
+
+        if(++slot -> generation == 0)
+            slot -> generation=1;
+
+        freeSlots.push_back((std::uint32_t)id);
+        running--;
+
+        return true;
+    }
+
+    // a game saved by Game::snapshot, going on in a new slot
+    Id restore(CodeRepo& repo,StatisticsRepo& stats,const std::string& data)
+    {
+        Id id;
+        switch(GameSnapshot::modeOf(data))
+        {
+            case GameMode::GuessLimited:
+                id=create<guessLimitedGame>(repo,stats,true,true);
+                break;
+            case GameMode::TimeAttack:
+                id=create<timeAttackGame>(repo,stats,true,true);
+                break;
+            default:
+                id=create<pointGame>(repo,stats,false,false);
+                break;
+        }
+
+        try
+        {
+            get(id) -> restore(data);
+        }
+        catch(...)
+        {
+            release(id);
+            throw;
+        }
+
+        return id;
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return running;
+    }
+};
+
+class AutoGuess
+{
+private:
+    const std::string alphabet_="abcdefghijklmnopqrstuvwxyz0123456789_^(){};%=<>+-*&|\"";
+
+    const char placeholder='@';
+    const char fuzzyholder='#';
+
+    const int guessLength=3;
+    
+    const std::vector<std::string> keywords=
+    {
+        "int","for","if(","els","ret","urn","cla","ass","nam","esp",
+        "#in","ude","std","siz","lon","eof","nul","ptr","new","del",
+        "ete","whi","ile","con","st ","cou","t<<","cin",">> ","%d ",
+        "sca","pri","ntf","<<\"", "\"<<"
+    };
+    
+    int count;
+
+public:
+    AutoGuess():count(0){};
+
+    // start over for a new game
+    void reset()
+    {
+        count=0;
+    }
+
+    std::string guess(const std::vector<std::string>& mask,GameRng& rng)
+    {
+        if(count == (int)keywords.size())
+            return random(rng);
+
+        bool visited=false;
+        for(auto& line:mask)
+        {
+            for(int i=0;i <= (int)line.size()-guessLength;i++)
+                if(line.compare(i,guessLength,keywords[count]) == 0)
+                    visited=true;
+        }
+
+        count++;
+
+        if(visited)
+            return guess(mask,rng);
+        
+        return keywords[count-1];
+    }
+
+    std::string random(GameRng& rng)
+    {
+        std::string result;
+
+        for(int i=0;i<guessLength;i++)
+            result += alphabet_[rng.below((std::uint32_t)alphabet_.size())];
+        
+        return result;
+    }
+};
+
+class UI
+{
+private:
+    fs::path root;
+    CodeRepo repo;
+
+    StatisticsRepo stats;
+    SessionManager sessions;
+
+    bool showPID=true;
+
+    static constexpr int historyPage=20;
+
+public:
+    UI():root(fs::current_path()),repo(root/"CodeSnippets"),stats(root/"Statistics.dat")
+    {
+    };
+    
+    void clearScreen()
+    {
+    #ifdef _WIN32
+        // for backward compatibility
+        std::cout << "\x1B[2J\x1B[H";
+        std::cout << "\x1B[3J";
+    #else
+        std::cout << "\x1B[2J\x1B[H\x1B[3J";
+    #endif
+
+        std::cout.flush();
+    }
+    
+    void pause()
     {
         std::cout << "\n--Enter anything to get back--\n";
         std::cin.get();
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
     }
-    
-    void print(const std::vector<std::string>& lines)
+    
+    void print(const std::vector<std::string>& lines)
+    {
+        for(auto& line:lines)
+            std::cout << line << '\n';
+    }
+    
+    void mainloop()
+    {
+        while(true)
+        {
+            clearScreen();
+
+            showStartPage();
+
+            char op;
+            std::cin >> op;
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+
+            switch(op)
+            {
+                case 'P':
+                    showGamePage();
+                    break;
+                case 'R':
+                    showRulePage();
+                    break;
+                case 'C':
+                    showCodePage();
+                    break;
+                case 'S':
+                    showStatisticsPage();
+                    break;
+                case 'E':
+                    return;
+            }
+        }
+    }
+    
+    void showStartPage()
+    {
+        clearScreen();
+
+        std::cout << "Play(P)\n";
+        std::cout << "Rule(R)\n";
+        std::cout << "Code(C)\n";
+        std::cout << "Stats(S)\n";
+        std::cout << "Exit(E)\n";
+    }
+    
+    void showRulePage()
+    {
+        clearScreen();
+        
+        std::cout << "Code Wordle\n\n";
+        std::cout << "You will be given a random code snippet.\n";
+        std::cout << "Initially, all characters are hidden.\n";
+        std::cout << "All you can see is the shape of the code snippet.\n\n";
+        std::cout << "Your goal is to guess out the code snippet.\n";
+        std::cout << "To achieve this, you can enter a substring of the code snippet length >= 3.\n";
+        std::cout << "Then the matching characters will be revealed.\n\n";
+        std::cout << "There's also fuzzy match\n";
+        std::cout << "If there's a substring of the code snippet that only differs by 1 character\n";
+        std::cout << "The substring will change to fuzzy match characters!\n\n";
+        std::cout << "There are 3 game modes:\n";
+        std::cout << "Limited Guesses: Use less guesses as possible, to reduce the difficuly, reveal one character every 5 guesses\n";
+        std::cout << "Time Attack: Use less time as possible, to reduce the difficuly, reveal one character every 10 seconds\n";
+        std::cout << "Point: The score will be calculated based on the guesses. "
+                  << "Noteably the fuzzy match and the problem ID showing is disabled initially. "
+                  << "You can enable them but the score will be reduced.\n";
+        std::cout << "Daily Challenge: Limited Guesses on the same code snippet for every player of the day, "
+                  << "with a leaderboard of its own\n";
+        
+        pause();
+    }
+    
+    void showCodePage()
+    {
+        while(true)
+        {
+            clearScreen();
+
+            std::cout << "Code Repo\n";
+            std::cout << "List(L)\n";
+            std::cout << "Read(R)\n";
+            std::cout << "Add/Edit(A)\n";
+            std::cout << "Remove(M)\n";
+            std::cout << "Back(B)\n";
+
+            char op;
+            std::cin >> op;
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+            
+            clearScreen();
+
+            switch(op)
+            {
+                case 'L':
+                {
+                    auto ids=repo.list();
+                    if(ids.empty())
+                        std::cout << "No codesnippets\n";
+                    
+                    print(ids);
+
+                    pause();
+                    break;
+                }
+                case 'R':
+                {
+                    std::string pid;
+
+                    std::cout << "Enter the code ID to read: ";
+                    std::getline(std::cin,pid);
+                    
+                    auto data=repo.read(pid);
+                    if(data.empty())
+                        std::cout << "Code not found\n";
+                    else
+                    {
+                        std::cout << data << '\n';
+                        std::cout << stats.getSnippetSummary(pid) << '\n';
+                        print(stats.getLeaderboardLines(pid));
+                    }
+                    
+                    pause();
+                    break;
+                }
+                case 'A':
+                {
+                    std::string pid;
+                    
+                    std::cout << "Enter the code ID: ";
+                    std::getline(std::cin,pid);
+
+                    std::cout << "Enter the code, end with entering \"END\"\n";
+
+                    std::vector<std::string> lines;
+                    std::string line;
+
+                    while(true)
+                    {
+                        std::getline(std::cin,line);
+                        
+                        if(line == "END")
+                            break;
+                        
+                        lines.push_back(line);
+                    }
+
+                    try
+                    {
+                        repo.add(pid,lines);
+                    }
+                    catch(const std::exception& e)
+                    {
+                        std::cout << e.what() << '\n';
+                        pause();
+                    }
+                    break;
+                }
+                case 'M':
+                {
+                    std::string pid;
+                    
+                    std::cout << "Enter the code ID: ";
+                    std::getline(std::cin,pid);
+
+                    if(!repo.remove(pid))
+                        std::cout << "Code not found\n";
+                    else
+                        std::cout << "Code #" << pid << " removed\n";
+
+                    pause();
+                    break;
+                }
+                case 'B':
+                {
+                    // back
+
+                    return;
+                }
+            }
+        }
+    }
+    
+    void showStatisticsPage()
+    {
+        std::int64_t cursor=0;
+
+        while(true)
+        {
+            clearScreen();
+
+            print(stats.getStatistics());
+            print(stats.getHistoryLines(cursor,historyPage));
+
+            std::cout << "\n--Enter N for older games, P for newer games, F to filter, L for leaderboards, anything else to get back--\n";
+
+            std::string op;
+            std::getline(std::cin,op);
+
+            if(op == "N")
+            {
+                if(cursor+historyPage<stats.historySize())
+                    cursor += historyPage;
+            }
+            else
+                if(op == "P")
+                    cursor=std::max<std::int64_t>(0,cursor-historyPage);
+                else
+                    if(op == "F")
+                        showHistoryQueryPage();
+                    else
+                        if(op == "L")
+                        {
+                            clearScreen();
+                            print(stats.getLeaderboardLines());
+                            pause();
+                        }
+                        else
+                            return;
+        }
+    }
+
+    void showHistoryQueryPage()
+    {
+        HistoryQuery query;
+        std::string input;
+
+        std::cout << "Game mode, Limited Guesses(G)/Time Attack(T)/Point(P), empty for any: ";
+        std::getline(std::cin,input);
+        if(input == "G")
+            query.mode=(int)GameMode::GuessLimited;
+        if(input == "T")
+            query.mode=(int)GameMode::TimeAttack;
+        if(input == "P")
+            query.mode=(int)GameMode::Point;
+
+        std::cout << "Result, Win(W)/Lose(L), empty for any: ";
+        std::getline(std::cin,input);
+        if(input == "W")
+            query.result=1;
+        if(input == "L")
+            query.result=0;
+
+        std::cout << "Code ID, empty for any: ";
+        std::getline(std::cin,query.pid);
+
+        std::cout << "Last days, empty for any time: ";
+        std::getline(std::cin,input);
+        query.lastDays(std::atoi(input.c_str()));
+
+        while(true)
+        {
+            clearScreen();
+
+            auto lines=stats.queryLines(query,historyPage);
+            if(lines.empty())
+                std::cout << "No more games\n";
+
+            print(lines);
+
+            std::cout << "\n--Enter N for older games, anything else to get back--\n";
+
+            std::string op;
+            std::getline(std::cin,op);
+
+            if(op != "N" || lines.empty())
+                return;
+        }
+    }
+    
+    void showGamePage()
+    {
+        clearScreen();
+
+        std::cout << "Game Mode:\n";
+        std::cout << "Limited Guesses(G)\n";
+        std::cout << "Time Attack(T)\n";
+        std::cout << "Point(P)\n";
+        std::cout << "Daily Challenge(D)\n";
+
+        char op;
+        std::cin >> op;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+
+        SessionManager::Id id;
+
+        switch(op)
+        {
+            case 'G':
+                id=sessions.create<guessLimitedGame>(repo,stats,true,true);
+                break;
+            case 'T':
+                id=sessions.create<timeAttackGame>(repo,stats,true,true);
+                break;
+            case 'P':
+                id=sessions.create<pointGame>(repo,stats,false,false);
+                break;
+            case 'D':
+                id=sessions.create<guessLimitedGame>(repo,stats,true,false);
+                sessions.get(id) -> playDaily(repo.daily(GameRecord::today()));
+                break;
+            default:
+                return;
+        }
+
+        Game* game=sessions.get(id);
+
+        if(!game -> start())
+        {
+            sessions.release(id);
+
+            std::cout << "There's no codesnippets\n";
+            return;
+        }
+
+        std::vector<std::string> msg{};
+
+        AutoGuess ag;
+
+        while(true)
+        {
+            clearScreen();
+
+            auto lines=game -> getDisplayLines();
+
+            print(lines);
+            print(msg);
+
+            if(game -> isOver())
+            {
+                std::cout << game -> Lose() << '\n';
+
+                pause();
+                break;
+            }
+
+            if(game -> isFinished())
+            {
+                std::cout << game -> Win() << '\n';
+
+                pause();
+                break;
+            }
+
+            std::string guess;
+            std::getline(std::cin,guess);
+
+            // exit the game, and get loss
+            if(guess == "E")
+            {
+                std::cout << game -> Lose() << '\n';
+
+                pause();
+                break;
+            }
+
+            if(guess == "A")
+            {
+                msg=std::vector{ag.guess(game -> getMasked(),game -> random())};
+
+                continue;
+            }
+
+            msg=game -> makeGuess(guess);
+        }
+
+        // the statistics are saved by the writer thread
+        sessions.release(id);
+    }
+};
+
+class TimerWheel // hierarchical timing wheel: adding, cancelling and firing a timer are O(1)
+{
+public:
+    using Id=std::uint64_t; // the node generation in the high half, the node index in the low half, never 0
+
+    static constexpr int TICK_MS=10;
+
+private:
+    static constexpr int LEVEL_BITS=6;
+    static constexpr int SLOTS=1<<LEVEL_BITS;
+    static constexpr int LEVELS=4;      // 64^4 ticks, about 46 hours; later timers fire at the end
+    static constexpr std::uint64_t MAX_DELAY=(1ull<<(LEVEL_BITS*LEVELS))-1;
+    static constexpr std::uint32_t NIL=0xffffffffu;
+
+    struct Node
+    {
+        std::uint64_t expiry;       // in ticks
+        std::uint64_t payload;
+        std::uint32_t prev;
+        std::uint32_t next;
+        std::uint32_t generation{1};
+        std::int16_t level{-1};     // -1 when the node is free
+        std::int16_t slot;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> freeNodes;
+    std::uint32_t heads[LEVELS][SLOTS];
+
+    std::uint64_t current{0};   // the last tick processed
+    std::size_t count{0};
+
+    // the level is the highest group of bits where the expiry differs from now,
+    // so a node moves down a level each time its group comes around
+    void link(std::uint32_t index)
+    {
+        Node& node=nodes[index];
+
+        std::uint64_t diff=node.expiry^current;
+        int level=0;
+        while(level<LEVELS-1 && (diff>>(LEVEL_BITS*(level+1))) != 0)
+            level++;
+
+        int slot=(int)((node.expiry>>(LEVEL_BITS*level))&(SLOTS-1));
+
+        node.level=(std::int16_t)level;
+        node.slot=(std::int16_t)slot;
+        node.prev=NIL;
+        node.next=heads[level][slot];
+        if(node.next != NIL)
+            nodes[node.next].prev=index;
+        heads[level][slot]=index;
+    }
+
+    void unlink(std::uint32_t index)
+    {
+        Node& node=nodes[index];
+
+        if(node.prev != NIL)
+            nodes[node.prev].next=node.next;
+        else
+            heads[node.level][node.slot]=node.next;
+
+        if(node.next != NIL)
+            nodes[node.next].prev=node.prev;
+
+        node.level=-1;
+    }
+
+    void recycle(std::uint32_t index)
+    {
+        if(++nodes[index].generation == 0)
+            nodes[index].generation=1;
+
+        freeNodes.push_back(index);
+        count--;
+    }
+
+    // the nodes of a higher level slot whose time has come go down
+    void cascade(int level)
+    {
+        int slot=(int)((current>>(LEVEL_BITS*level))&(SLOTS-1));
+
+        std::uint32_t index=heads[level][slot];
+        heads[level][slot]=NIL;
+
+        while(index != NIL)
+        {
+            std::uint32_t next=nodes[index].next;
+            link(index);
+            index=next;
+        }
+    }
+
+public:
+    TimerWheel()
+    {
+        for(auto& level:heads)
+            for(auto& head:level)
+                head=NIL;
+    }
+
+    static std::uint64_t toTicks(std::uint64_t ms)
+    {
+        return ms/TICK_MS;
+    }
+
+    bool empty()
+    {
+        return count == 0;
+    }
+
+    std::size_t size()
+    {
+        return count;
+    }
+
+    // fires in delayMs or a little later, never earlier
+    Id schedule(std::uint64_t nowMs,std::uint64_t delayMs,std::uint64_t payload)
+    {
+        // nothing to fire in between, skip the idle ticks
+        if(count == 0)
+            current=std::max(current,toTicks(nowMs));
+
+        std::uint64_t delay=(delayMs+TICK_MS-1)/TICK_MS+1;
+        delay=std::min(delay,MAX_DELAY);
+
+        std::uint32_t index;
+        if(!freeNodes.empty())
+        {
+            index=freeNodes.back();
+            freeNodes.pop_back();
+        }
+        else
+        {
+            index=(std::uint32_t)nodes.size();
+            nodes.emplace_back();
+        }
+
+        Node& node=nodes[index];
+        node.expiry=std::max(current,toTicks(nowMs))+delay;
+        node.payload=payload;
+        link(index);
+        count++;
+
+        return ((Id)node.generation<<32)|index;
+    }
+
+    // false if the timer has fired or was cancelled already
+    bool cancel(Id id)
+    {
+        std::uint32_t index=(std::uint32_t)id;
+        if(id == 0 || index >= nodes.size())
+            return false;
+
+        Node& node=nodes[index];
+        if(node.level<0 || node.generation != (std::uint32_t)(id>>32))
+            return false;
+
+        unlink(index);
+        recycle(index);
+
+        return true;
+    }
+
+    // how long the caller may sleep before calling advance, -1 with no timer
+    std::int64_t msUntilNext(std::uint64_t nowMs)
+    {
+        if(count == 0)
+            return -1;
+
+        // the nodes on level 0 fire in this round, the others cascade at its end at the earliest
+        std::uint64_t ticks=SLOTS-(current&(SLOTS-1));
+        for(std::uint64_t t=(current&(SLOTS-1))+1;t<SLOTS;t++)
+            if(heads[0][t] != NIL)
+            {
+                ticks=t-(current&(SLOTS-1));
+                break;
+            }
+
+        std::uint64_t due=(current+ticks)*TICK_MS;
+        return due>nowMs ?(std::int64_t)(due-nowMs):0;
+    }
+
+    // fires every timer due by nowMs, fire(payload) may schedule and cancel timers
+    template<class Fire>
+    void advance(std::uint64_t nowMs,Fire&& fire)
+    {
+        std::uint64_t target=toTicks(nowMs);
+
+        while(current<target && count>0)
+        {
+            current++;
+
+            // from the top, so the nodes coming down are cascaded further in the same tick
+            int top=0;
+            while(top+1<LEVELS && (current&((1ull<<(LEVEL_BITS*(top+1)))-1)) == 0)
+                top++;
+
+            for(int level=top;level >= 1;level--)
+                cascade(level);
+
+            int slot=(int)(current&(SLOTS-1));
+            while(heads[0][slot] != NIL)
+            {
+                std::uint32_t index=heads[0][slot];
+                std::uint64_t payload=nodes[index].payload;
+
+                unlink(index);
+                recycle(index);
+
+                fire(payload);
+            }
+        }
+
+        current=std::max(current,target);
+    }
+};
+
+#ifdef __linux__
+class GameServer // the games over a line protocol; one epoll loop does the I/O, a thread pool runs the games
+{
+private:
+    // a request is one line: USER <id>, START <G|T|P|D> [seed], RESUME, GUESS <text>, AUTO, SHOW, END, STATS, DAILY or QUIT;
+    // the reply is "OK <n>", or "END <n>" when the game is over, followed by n lines, or one "ERR <message>" line.
+    // Between replies the server may push "TICK <n>" with the game after a timed reveal, or
+    // "EXPIRED <n>" with the result when the time is up.
+    // A running game is saved now and then, and when the server stops; RESUME goes on with it.
+    // Guests share one ID, so their games are not saved
+    // D is the daily challenge, the same snippet for everyone that day; DAILY shows its leaderboard
+    struct Session
+    {
+        // the event loop only
+        int fd{-1};
+        std::uint32_t serial{0};  // tells the timers of a reused fd apart
+        TimerWheel::Id timer{0};  // the next reveal or the end of its game
+        std::string input;
+        std::string output;
+        int pending{0};        // requests posted to the strand and not answered yet
+        bool playing=false;    // a game was running after the last answer
+
+        bool reading =true;    // watching EPOLLIN
+        bool writing =false;   // watching EPOLLOUT
+        bool eof     =false;   // the client sends no more, close once everything is answered
+        bool quitting=false;   // no more requests, close once the replies are sent
+        bool broken  =false;   // close now
+
+        // the strand only, it runs the requests of the session one by one and in order
+        std::string user=GUEST;
+        std::shared_ptr<StatisticsRepo> stats; // kept while the session lives, its game refers to it
+        SessionManager::Id game{0};            // 0 when no game is running
+        AutoGuess autoGuess;
+        std::string replies;                   // of the request being handled
+        bool quitRequested=false;
+        bool dirty=false;                      // the game changed since it was saved
+        bool saved=false;                      // a snapshot of the game is on disk
+
+        Strand strand;
+
+        Session(ThreadPool& pool):strand(pool){}
+    };
+
+    struct Completion
+    {
+        std::shared_ptr<Session> session;
+        std::string replies;
+        bool quit;
+        bool playing;
+        std::int64_t nextEventMs; // -1 if the game waits for the player
+    };
+
+    sigset_t stopSignals; // blocked before the writer thread starts, so only the loop sees them
+
+    CodeRepo repo;
+    StatisticsStore store;
+    SessionManager games;
+    ReplayWriter replays; // every finished game, to play again
+
+    int listenFd=-1;
+    int epollFd =-1;
+    int signalFd=-1;
+    int wakeFd  =-1; // the workers wake the loop when replies are ready
+    fs::path socketPath;
+
+    std::unordered_map<int,std::shared_ptr<Session> > sessions;
+    std::uint32_t nextSerial{0};
+
+    TimerWheel timers; // the loop only, one timer per session with a timed game
+
+    std::mutex doneMtx;
+    std::vector<Completion> done;      // filled by the workers
+    std::vector<Completion> collected; // emptied by the loop
+
+    ThreadPool pool; // last, so it stops before the games go away
+
+    static constexpr int MAX_EVENTS=256;
+    static constexpr int MAX_PENDING=16; // a client that pipelines more waits until they're answered
+    static constexpr std::size_t READ_SIZE =4096;
+    static constexpr std::size_t MAX_LINE  =4096;
+    static constexpr std::size_t MAX_OUTPUT=1<<20; // a client that never reads is dropped
+
+    static constexpr std::uint64_t CHECKPOINT_MS=5000; // how often the changed games are saved
+    static constexpr const char* GUEST="guest";       // the user of a session before USER
+    static constexpr std::uint64_t CHECKPOINT   =0;    // the timer key, no session has serial 0
+
+    // coarse is enough for timers counted in ticks, and cheaper to read
+    static std::uint64_t nowMs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC_COARSE,&now);
+
+        return (std::uint64_t)now.tv_sec*1000+now.tv_nsec/1000000;
+    }
+
+    static sigset_t blockStopSignals()
+    {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask,SIGINT);
+        sigaddset(&mask,SIGTERM);
+        pthread_sigmask(SIG_BLOCK,&mask,nullptr);
+
+        return mask;
+    }
+
+    void watch(int fd,std::uint32_t events,int op=EPOLL_CTL_ADD)
+    {
+        epoll_event event{};
+        event.events=events;
+        event.data.fd=fd;
+
+        if(epoll_ctl(epollFd,op,fd,&event) != 0)
+            throw AppException("Cannot watch socket: "+std::string(std::strerror(errno)));
+    }
+
+    // "unix:<path>", "<port>" or "<ipv4>:<port>"; a bare port listens on the loopback only
+    void listenOn(const std::string& address)
+    {
+        if(address.compare(0,5,"unix:") == 0)
+        {
+            socketPath=address.substr(5);
+
+            sockaddr_un addr{};
+            addr.sun_family=AF_UNIX;
+            if(socketPath.empty() || socketPath.native().size() >= sizeof(addr.sun_path))
+                throw AppException("Invalid socket path: "+address);
+            std::strcpy(addr.sun_path,socketPath.c_str());
+
+            // a socket left behind by an earlier run
+            if(fs::is_socket(socketPath))
+                fs::remove(socketPath);
+
+            listenFd=socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+            if(listenFd<0 || bind(listenFd,(sockaddr*)&addr,sizeof(addr)) != 0)
+                throw AppException("Cannot bind "+address+": "+std::strerror(errno));
+        }
+        else
+        {
+            std::string host="127.0.0.1";
+            std::string port=address;
+
+            auto colon=address.rfind(':');
+            if(colon != std::string::npos)
+            {
+                host=address.substr(0,colon);
+                port=address.substr(colon+1);
+            }
+
+            sockaddr_in addr{};
+            addr.sin_family=AF_INET;
+
+            int value=-1;
+            auto [end,ec]=std::from_chars(port.data(),port.data()+port.size(),value);
+            if(ec != std::errc() || end != port.data()+port.size() || value<0 || value>65535 ||
+               inet_pton(AF_INET,host.c_str(),&addr.sin_addr) != 1)
+                throw AppException("Invalid address: "+address);
+            addr.sin_port=htons((std::uint16_t)value);
+
+            listenFd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+
+            int on=1;
+            if(listenFd >= 0)
+                setsockopt(listenFd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+
+            if(listenFd<0 || bind(listenFd,(sockaddr*)&addr,sizeof(addr)) != 0)
+                throw AppException("Cannot bind "+address+": "+std::strerror(errno));
+        }
+
+        if(listen(listenFd,SOMAXCONN) != 0)
+            throw AppException("Cannot listen on "+address+": "+std::strerror(errno));
+    }
+
+    void acceptAll()
+    {
+        while(true)
+        {
+            int fd=accept4(listenFd,nullptr,nullptr,SOCK_NONBLOCK|SOCK_CLOEXEC);
+            if(fd<0)
+            {
+                if(errno == EINTR || errno == ECONNABORTED)
+                    continue;
+
+                // EAGAIN when nothing is pending; out of descriptors, try again on the next event
+                if(errno != EAGAIN && errno != EWOULDBLOCK)
+                    std::cerr << "accept: " << std::strerror(errno) << '\n';
+                return;
+            }
+
+            auto session=std::make_shared<Session>(pool);
+            session -> fd=fd;
+            session -> serial=++nextSerial;
+
+            watch(fd,EPOLLIN|EPOLLRDHUP);
+            sessions[fd]=std::move(session);
+        }
+    }
+
+    // each line of the game becomes one line of the reply, even if it holds newlines itself
+    static void reply(Session& session,const std::string& status,const std::vector<std::string>& lines)
+    {
+        std::string body;
+        int count=0;
+
+        for(auto& line:lines)
+        {
+            std::size_t start=0;
+            while(true)
+            {
+                auto end=line.find('\n',start);
+                body.append(line,start,end == std::string::npos ?std::string::npos:end-start);
+                body += '\n';
+                count++;
+
+                if(end == std::string::npos)
+                    break;
+                start=end+1;
+            }
+        }
+
+        session.replies += status+" "+std::to_string(count)+"\n"+body;
+    }
+
+    static void error(Session& session,const std::string& msg)
+    {
+        session.replies += "ERR "+msg+"\n";
+    }
+
+    fs::path snapshotPath(const std::string& user)
+    {
+        return store.userPath(user).replace_filename("Game.snap");
+    }
+
+    // the saves, drops and claims of a user's snapshot, between the servers sharing Profiles too
+    FileLock snapshotLock(const std::string& user)
+    {
+        return FileLock(store.userPath(user).replace_filename("Game.lock"));
+    }
+
+    // the running game of the session next to the statistics of its user, replacing the last one
+    void saveSnapshot(Session& session)
+    {
+        thread_local std::string buffer;
+        buffer.clear();
+        games.get(session.game) -> snapshot(buffer);
+
+        auto path=snapshotPath(session.user);
+        auto temp=path;
+        temp += ".tmp";
+
+        FileLock lock=snapshotLock(session.user);
+
+        std::ofstream fout(temp,std::ios::binary);
+        if(!fout)
+            throw AppException("Could not open file: "+temp.string());
+
+        fout.write(buffer.data(),buffer.size());
+        fout.close();
+
+        fs::rename(temp,path);
+
+        session.saved=true;
+        session.dirty=false;
+    }
+
+    void dropSnapshot(Session& session)
+    {
+        if(!session.saved)
+            return;
+
+        FileLock lock=snapshotLock(session.user);
+
+        std::error_code ec;
+        fs::remove(snapshotPath(session.user),ec);
+        session.saved=false;
+    }
+
+    // takes the saved game of the user off the disk, so no other session resumes it too;
+    // empty when there is none
+    std::string claimSnapshot(const std::string& user)
+    {
+        auto path=snapshotPath(user);
+        FileLock lock=snapshotLock(user);
+
+        std::ifstream fin(path,std::ios::binary);
+        if(!fin)
+            return {};
+
+        std::string data((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+        fin.close();
+
+        fs::remove(path);
+
+        return data;
+    }
+
+    void checkpoint(Session& session)
+    {
+        if(!session.game || !session.dirty || session.user == GUEST)
+            return;
+
+        try
+        {
+            saveSnapshot(session);
+        }
+        catch(const std::exception& e)
+        {
+            // the game goes on, the next checkpoint tries again
+            std::cerr << e.what() << '\n';
+        }
+    }
+
+    void endGame(Session& session,std::vector<std::string> lines,const std::string& result,const std::string& status="END")
     {
-        for(auto& line:lines)
-            std::cout << line << '\n';
+        lines.push_back(result);
+
+        replays.write(games.get(session.game) -> replayLog());
+        games.release(session.game);
+        session.game=0;
+        dropSnapshot(session);
+
+        reply(session,status,lines);
     }
-    
-    void mainloop()
+
+    // the timer of the session fired: reveal, or end the game, without waiting for the player
+    void tick(Session& session)
     {
-        while(true)
+        if(!session.game)
+            return;
+
+        Game& game=*games.get(session.game);
+
+        if(game.isOver())
+            return endGame(session,{},game.Lose(),"EXPIRED");
+
+        if(game.advanceClock()>0)
+            reply(session,"TICK",game.getDisplayLines());
+    }
+
+    void expire(std::uint64_t key)
+    {
+        // the sessions whose game changed save it on their strands, each on its own
+        if(key == CHECKPOINT)
         {
-            clearScreen();
+            for(auto& [fd,session]:sessions)
+                if(session -> playing)
+                    session -> strand.post([this,session=session]{checkpoint(*session);});
 
-            showStartPage();
+            timers.schedule(nowMs(),CHECKPOINT_MS,CHECKPOINT);
+            return;
+        }
 
-            char op;
-            std::cin >> op;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+        auto it=sessions.find((int)(key&0xffffffffu));
+        if(it == sessions.end() || it -> second -> serial != (std::uint32_t)(key>>32))
+            return;
 
-            switch(op)
+        auto session=it -> second;
+        session -> timer=0;
+
+        post(session,[this](Session& target){tick(target);});
+    }
+
+    void handle(Session& session,std::string line)
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        auto space=line.find(' ');
+        std::string command=line.substr(0,space);
+        std::string arg=space == std::string::npos ?"":line.substr(space+1);
+
+        if(command == "QUIT")
+        {
+            reply(session,"OK",{});
+            session.quitRequested=true;
+
+            return;
+        }
+
+        if(command == "USER")
+        {
+            if(session.game)
+                return error(session,"A game is running");
+
+            store.userPath(arg); // throws for an invalid ID
+
+            session.user=arg;
+            session.stats.reset();
+
+            return reply(session,"OK",{});
+        }
+
+        if(!session.stats)
+            session.stats=store.get(session.user);
+
+        if(command == "STATS")
+            return reply(session,"OK",session.stats -> getStatistics());
+
+        if(command == "DAILY")
+            return reply(session,"OK",store.getLeaderboardLines(LeaderboardTable::dailyKey(GameRecord::today())));
+
+        if(command == "START")
+        {
+            if(session.game)
+                return error(session,"A game is running");
+
+            // an optional seed plays a recorded game again
+            auto split=arg.find(' ');
+            std::string modeName=arg.substr(0,split);
+            std::string seedText=split == std::string::npos ?"":arg.substr(split+1);
+
+            std::uint64_t seed=0;
+            if(!seedText.empty())
             {
-                case 'P':
-                    showGamePage();
-                    break;
-                case 'R':
-                    showRulePage();
-                    break;
-                case 'C':
-                    showCodePage();
-                    break;
-                case 'S':
-                    showStatisticsPage();
-                    break;
-                case 'E':
-                    return;
+                auto [end,ec]=std::from_chars(seedText.data(),seedText.data()+seedText.size(),seed);
+                if(ec != std::errc() || end != seedText.data()+seedText.size())
+                    return error(session,"Invalid seed: "+seedText);
+            }
+
+            // the same options as the console
+            SessionManager::Id id;
+            if(modeName == "G")
+                id=games.create<guessLimitedGame>(repo,*session.stats,true,true);
+            else if(modeName == "T")
+                id=games.create<timeAttackGame>(repo,*session.stats,true,true);
+            else if(modeName == "P")
+                id=games.create<pointGame>(repo,*session.stats,false,false);
+            else if(modeName == "D" && seedText.empty())
+                id=games.create<guessLimitedGame>(repo,*session.stats,true,false);
+            else if(modeName == "D")
+                return error(session,"The daily challenge has its own seed");
+            else
+                return error(session,"Unknown mode: "+modeName);
+
+            Game& game=*games.get(id);
+            if(modeName == "D")
+                game.playDaily(repo.daily(GameRecord::today()));
+            if(!seedText.empty())
+                game.setSeed(seed);
+            game.record(true);
+
+            bool started=false;
+            try
+            {
+                started=game.start();
             }
+            catch(...)
+            {
+                games.release(id);
+                throw;
+            }
+
+            if(!started)
+            {
+                games.release(id);
+                return error(session,"There's no codesnippets");
+            }
+
+            session.game=id;
+            session.autoGuess.reset();
+
+            auto lines=game.getDisplayLines();
+            lines.insert(lines.begin(),"Seed: "+std::to_string(game.getSeed()));
+
+            return reply(session,"OK",lines);
         }
+
+        if(command == "RESUME")
+        {
+            if(session.game)
+                return error(session,"A game is running");
+
+            if(session.user == GUEST)
+                return error(session,"Guests have no saved games");
+
+            std::string data=claimSnapshot(session.user);
+            if(data.empty())
+                return error(session,"No saved game");
+
+            // a snapshot that can not be restored is dropped, nobody could go on with it
+            session.game=games.restore(repo,*session.stats,data);
+
+            // saved again at the next checkpoint, by this session only
+            session.dirty=true;
+            session.autoGuess.reset();
+
+            Game& game=*games.get(session.game);
+            auto lines=game.getDisplayLines();
+            lines.insert(lines.begin(),"Seed: "+std::to_string(game.getSeed()));
+
+            return reply(session,"OK",lines);
+        }
+
+        if(command != "SHOW" && command != "GUESS" && command != "AUTO" && command != "END")
+            return error(session,"Unknown command: "+command);
+
+        if(!session.game)
+            return error(session,"No game is running");
+
+        Game& game=*games.get(session.game);
+
+        if(command == "END")
+            return endGame(session,{},game.Lose());
+
+        // the time may have run out since the last request
+        if(game.isOver())
+            return endGame(session,{},game.Lose());
+
+        if(command == "SHOW")
+            return reply(session,"OK",game.getDisplayLines());
+
+        if(command == "AUTO")
+            return reply(session,"OK",{session.autoGuess.guess(game.getMasked(),game.random())});
+
+        auto msg=game.makeGuess(arg);
+
+        if(game.isFinished())
+            return endGame(session,msg,game.Win());
+
+        if(game.isOver())
+            return endGame(session,msg,game.Lose());
+
+        reply(session,"OK",msg);
     }
-    
-    void showStartPage()
+
+    // runs work on the strand of the session, the replies go back to the loop through wakeFd
+    void post(const std::shared_ptr<Session>& session,std::function<void(Session&)> work)
     {
-        clearScreen();
+        session -> pending++;
+        session -> strand.post([this,session,work=std::move(work)]
+        {
+            try
+            {
+                work(*session);
+            }
+            catch(const std::exception& e)
+            {
+                error(*session,e.what());
+            }
 
-        std::cout << "Play(P)\n";
-        std::cout << "Rule(R)\n";
-        std::cout << "Code(C)\n";
-        std::cout << "Stats(S)\n";
-        std::cout << "Exit(E)\n";
+            std::int64_t nextEventMs=-1;
+            if(session -> game)
+            {
+                nextEventMs=games.get(session -> game) -> nextEventMs();
+                session -> dirty=true;
+            }
+
+            Completion completion{session,std::move(session -> replies),session -> quitRequested,
+                                  session -> game != 0,nextEventMs};
+            session -> replies.clear();
+
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lock(doneMtx);
+                wake=done.empty();
+                done.push_back(std::move(completion));
+            }
+
+            std::uint64_t one=1;
+            if(wake && write(wakeFd,&one,sizeof(one)) < 0)
+                std::cerr << "wake: " << std::strerror(errno) << '\n';
+        });
     }
-    
-    void showRulePage()
+
+    // hands the complete lines to the strand, a few at a time so one client cannot flood the pool
+    void dispatch(const std::shared_ptr<Session>& session)
     {
-        clearScreen();
-        
-        std::cout << "Code Wordle\n\n";
-        std::cout << "You will be given a random code snippet.\n";
-        std::cout << "Initially, all characters are hidden.\n";
-        std::cout << "All you can see is the shape of the code snippet.\n\n";
-        std::cout << "Your goal is to guess out the code snippet.\n";
-        std::cout << "To achieve this, you can enter a substring of the code snippet length >= 3.\n";
-        std::cout << "Then the matching characters will be revealed.\n\n";
-        std::cout << "There's also fuzzy match\n";
-        std::cout << "If there's a substring of the code snippet that only differs by 1 character\n";
-        std::cout << "The substring will change to fuzzy match characters!\n\n";
-        std::cout << "There are 3 game modes:\n";
-        std::cout << "Limited Guesses: Use less guesses as possible, to reduce the difficuly, reveal one character every 5 guesses\n";
-        std::cout << "Time Attack: Use less time as possible, to reduce the difficuly, reveal one character every 10 seconds\n";
-        std::cout << "Point: The score will be calculated based on the guesses. "
-                  << "Noteably the fuzzy match and the problem ID showing is disabled initially. "
-                  << "You can enable them but the score will be reduced.\n";
-        
-        pause();
+        std::string& input=session -> input;
+
+        std::size_t start=0;
+        while(!session -> quitting && session -> pending<MAX_PENDING)
+        {
+            auto end=input.find('\n',start);
+            if(end == std::string::npos)
+                break;
+
+            // the requests that were already read after a QUIT are dropped
+            post(session,[this,line=input.substr(start,end-start)](Session& target)
+            {
+                if(!target.quitRequested)
+                    handle(target,line);
+            });
+            start=end+1;
+        }
+
+        input.erase(0,start);
+
+        if(!session -> quitting && input.size()>MAX_LINE && input.find('\n') == std::string::npos)
+        {
+            post(session,[](Session& target)
+            {
+                error(target,"Line too long");
+                target.quitRequested=true;
+            });
+            session -> quitting=true;
+        }
     }
-    
-    void showCodePage()
+
+    void receive(const std::shared_ptr<Session>& session)
     {
-        while(true)
+        // one read per event, so a busy client cannot starve the others
+        char buffer[READ_SIZE];
+
+        ssize_t n=recv(session -> fd,buffer,sizeof(buffer),0);
+        if(n>0)
+            session -> input.append(buffer,n);
+        else if(n == 0)
+            session -> eof=true; // answer what has arrived, then close
+        else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            session -> broken=true;
+
+        dispatch(session);
+    }
+
+    // the replies the workers have finished
+    void collect()
+    {
+        std::uint64_t count;
+        if(read(wakeFd,&count,sizeof(count)) < 0 && errno != EAGAIN)
+            std::cerr << "wake: " << std::strerror(errno) << '\n';
+
         {
-            clearScreen();
+            std::lock_guard<std::mutex> lock(doneMtx);
+            collected.swap(done);
+        }
 
-            std::cout << "Code Repo\n";
-            std::cout << "List(L)\n";
-            std::cout << "Read(R)\n";
-            std::cout << "Add/Edit(A)\n";
-            std::cout << "Remove(M)\n";
-            std::cout << "Back(B)\n";
+        for(auto& completion:collected)
+        {
+            auto& session=completion.session;
+            session -> pending--;
 
-            char op;
-            std::cin >> op;
-            std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
-            
-            clearScreen();
+            // closed while the request ran
+            if(session -> fd<0)
+                continue;
 
-            switch(op)
+            session -> output += completion.replies;
+            session -> playing=completion.playing;
+            if(completion.quit)
+                session -> quitting=true;
+
+            // the newest answer knows best when the game needs the clock next
+            timers.cancel(session -> timer);
+            session -> timer=0;
+            if(completion.nextEventMs >= 0)
             {
-                case 'L':
-                {
-                    auto ids=repo.list();
-                    if(ids.empty())
-                        std::cout << "No codesnippets\n";
-                    
-                    print(ids);
+                std::uint64_t key=((std::uint64_t)session -> serial<<32)|(std::uint32_t)session -> fd;
+                session -> timer=timers.schedule(nowMs(),completion.nextEventMs,key);
+            }
 
-                    pause();
-                    break;
-                }
-                case 'R':
-                {
-                    std::string pid;
+            dispatch(session);
+            update(session);
+        }
 
-                    std::cout << "Enter the code ID to read: ";
-                    std::getline(std::cin,pid);
-                    
-                    auto data=repo.read(pid);
-                    if(data.empty())
-                        std::cout << "Code not found\n";
-                    else
-                        std::cout << data << '\n';
-                    
-                    pause();
-                    break;
-                }
-                case 'A':
-                {
-                    std::string pid;
-                    
-                    std::cout << "Enter the code ID: ";
-                    std::getline(std::cin,pid);
+        collected.clear();
+    }
 
-                    std::cout << "Enter the code, end with entering \"END\"\n";
+    void transmit(Session& session)
+    {
+        std::size_t sent=0;
+        while(sent<session.output.size())
+        {
+            ssize_t n=send(session.fd,session.output.data()+sent,session.output.size()-sent,MSG_NOSIGNAL);
+            if(n>0)
+            {
+                sent += n;
+                continue;
+            }
 
-                    std::vector<std::string> lines;
-                    std::string line;
+            if(n<0 && errno == EINTR)
+                continue;
 
-                    while(true)
-                    {
-                        std::getline(std::cin,line);
-                        
-                        if(line == "END")
-                            break;
-                        
-                        lines.push_back(line);
-                    }
+            if(n<0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
 
-                    repo.add(pid,lines);
-                    break;
-                }
-                case 'M':
-                {
-                    std::string pid;
-                    
-                    std::cout << "Enter the code ID: ";
-                    std::getline(std::cin,pid);
+            session.broken=true;
+            return;
+        }
+
+        session.output.erase(0,sent);
+
+        if(session.output.size()>MAX_OUTPUT)
+            session.broken=true;
+    }
+
+    void close(const std::shared_ptr<Session>& session,bool leaving)
+    {
+        int fd=session -> fd;
+        ::close(fd);
+        session -> fd=-1;
+        sessions.erase(fd);
+
+        timers.cancel(session -> timer);
+        session -> timer=0;
+
+        // the game belongs to the strand, it ends after the requests already posted
+        post(session,[this,leaving](Session& target)
+        {
+            // leaving in the middle of a game loses it, like ending it;
+            // when the server stops, the game is saved to go on with later, except a guest's
+            if(target.game && (leaving || target.user == GUEST))
+            {
+                Game& game=*games.get(target.game);
+                game.Lose();
+                replays.write(game.replayLog());
+                dropSnapshot(target);
+            }
+            else if(target.game)
+            {
+                target.dirty=true;
+                checkpoint(target);
+            }
+
+            games.release(target.game);
+            target.game=0;
+        });
+    }
 
-                    if(!repo.remove(pid))
-                        std::cout << "Code not found\n";
-                    else
-                        std::cout << "Code #" << pid << " removed\n";
+    void update(const std::shared_ptr<Session>& session)
+    {
+        if(!session -> broken)
+            transmit(*session);
 
-                    pause();
-                    break;
-                }
-                case 'B':
-                {
-                    // back
+        if(session -> broken)
+            return close(session,true);
 
-                    return;
-                }
-            }
+        if(session -> pending == 0 && session -> output.empty() && (session -> quitting || session -> eof))
+            return close(session,true);
+
+        // EPOLLIN while more requests are welcome, EPOLLOUT while replies are waiting
+        bool reading=!session -> quitting && !session -> eof && session -> pending<MAX_PENDING;
+        bool writing=!session -> output.empty();
+        if(reading != session -> reading || writing != session -> writing)
+        {
+            session -> reading=reading;
+            session -> writing=writing;
+            watch(session -> fd,(reading ?(std::uint32_t)(EPOLLIN|EPOLLRDHUP):0u)|(writing ?(std::uint32_t)EPOLLOUT:0u),EPOLL_CTL_MOD);
         }
     }
-    
-    void showStatisticsPage()
+
+    void onEvent(int fd,std::uint32_t events)
     {
-        clearScreen();
+        auto it=sessions.find(fd);
+        if(it == sessions.end())
+            return;
 
-        auto lines=stats.getStatistics();
-        print(lines);
+        auto session=it -> second; // closing erases it from the map
 
-        pause();
+        // a hang-up is reported even when nothing is watched, there's nobody left to answer
+        if(events & (EPOLLHUP|EPOLLERR))
+            session -> broken=true;
+        else if(events & (EPOLLIN|EPOLLRDHUP))
+            receive(session);
+
+        update(session);
     }
-    
-    void showGamePage()
+
+public:
+    GameServer(const fs::path& root,const std::string& address)
+              :stopSignals(blockStopSignals()),repo(root/"CodeSnippets"),store(root/"Profiles"),replays(root/"Replays.dat")
     {
-        clearScreen();
+        // the first games shouldn't wait for the disk
+        repo.warmUp();
 
-        std::cout << "Game Mode:\n";
-        std::cout << "Limited Guesses(G)\n";
-        std::cout << "Time Attack(T)\n";
-        std::cout << "Point(P)\n";
+        listenOn(address);
 
-        char op;
-        std::cin >> op;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+        epollFd=epoll_create1(EPOLL_CLOEXEC);
+        signalFd=signalfd(-1,&stopSignals,SFD_NONBLOCK|SFD_CLOEXEC);
+        wakeFd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+        if(epollFd<0 || signalFd<0 || wakeFd<0)
+            throw AppException("Cannot create the event loop: "+std::string(std::strerror(errno)));
 
-        Game* game=nullptr;
+        watch(listenFd,EPOLLIN);
+        watch(signalFd,EPOLLIN);
+        watch(wakeFd,EPOLLIN);
 
-        switch(op)
-        {
-            case 'G':
-                game=new guessLimitedGame(repo,stats,true,true);
-                break;
-            case 'T':
-                game=new timeAttackGame(repo,stats,true,true);
-                break;
-            case 'P':
-                game=new pointGame(repo,stats,false,false);
-                break;
-            default:
-                delete game;
-                return;
-        }
+        timers.schedule(nowMs(),CHECKPOINT_MS,CHECKPOINT);
+    }
 
-        if(!game -> start())
-        {
-            std::cout << "There's no codesnippets\n";
-            return;
-        }
+    GameServer(const GameServer&)=delete;
+    GameServer& operator=(const GameServer&)=delete;
 
-        std::vector<std::string> msg{};
+    ~GameServer()
+    {
+        // the games still running are dropped, it's not the players' fault
+        while(!sessions.empty())
+            close(sessions.begin() -> second,false);
 
-        AutoGuess ag;
+        pool.wait();
 
-        while(true)
-        {
-            clearScreen();
+        for(int fd:{listenFd,epollFd,signalFd,wakeFd})
+            if(fd >= 0)
+                ::close(fd);
 
-            auto lines=game -> getDisplayLines();
+        if(!socketPath.empty())
+            fs::remove(socketPath);
+    }
 
-            print(lines);
-            print(msg);
+    // the port actually bound, useful when listening on port 0
+    int port()
+    {
+        sockaddr_in addr{};
+        socklen_t size=sizeof(addr);
 
-            if(game -> isOver())
-            {
-                std::cout << game -> Lose() << '\n';
+        if(!socketPath.empty() || getsockname(listenFd,(sockaddr*)&addr,&size) != 0)
+            return -1;
 
-                pause();
-                break;
-            }
+        return ntohs(addr.sin_port);
+    }
 
-            if(game -> isFinished())
-            {
-                std::cout << game -> Win() << '\n';
+    std::size_t sessionCount()
+    {
+        return sessions.size();
+    }
 
-                pause();
-                break;
-            }
+    // serve until SIGINT or SIGTERM
+    void run()
+    {
+        epoll_event events[MAX_EVENTS];
 
-            std::string guess;
-            std::getline(std::cin,guess);
+        while(true)
+        {
+            // sleep until the next timer at most, no session is polled
+            std::int64_t timeout=timers.msUntilNext(nowMs());
 
-            // exit the game, and get loss
-            if(guess == "E")
+            int n=epoll_wait(epollFd,events,MAX_EVENTS,timeout<0 ?-1:(int)std::min<std::int64_t>(timeout,INT32_MAX));
+            if(n<0)
             {
-                std::cout << game -> Lose() << '\n';
+                if(errno == EINTR)
+                    continue;
 
-                pause();
-                break;
+                throw AppException("epoll_wait failed: "+std::string(std::strerror(errno)));
             }
 
-            if(guess == "A")
+            for(int i=0;i<n;i++)
             {
-                msg=std::vector{ag.guess(game -> getMasked())};
+                int fd=events[i].data.fd;
 
-                continue;
+                if(fd == signalFd)
+                    return;
+
+                if(fd == listenFd)
+                    acceptAll();
+                else if(fd == wakeFd)
+                    collect();
+                else
+                    onEvent(fd,events[i].events);
             }
 
-            msg=game -> makeGuess(guess);
+            timers.advance(nowMs(),[this](std::uint64_t key){expire(key);});
         }
-
-        delete game;
-
-        stats.saveToFile();
     }
 };
+#endif
+
+// the tests in tests/ include this file without the GUI and main()
+#ifndef CORDLE_NO_MAIN
 
 #include <FL/Fl.H>
 #include <FL/Fl_Window.H>
@@ -1331,6 +7952,8 @@ public:
 #include <FL/Fl_Text_Display.H>
 #include <FL/fl_ask.H>
 #include <FL/Fl_Box.H> 
+#include <FL/Fl_Choice.H>
+#include <FL/Fl_Int_Input.H>
 
 class GUI {
 private:
@@ -1338,7 +7961,10 @@ private:
     CodeRepo repo;
 
     StatisticsRepo stats;
-    Game *game;
+
+    SessionManager sessions;
+    SessionManager::Id gameId{0};
+    Game *game;               // the game of gameId, nullptr when none is running
 
     AutoGuess autoGuesser;
 
@@ -1348,6 +7974,17 @@ private:
 
     Fl_Window* statsWindow;
     Fl_Text_Buffer *statsBuffer;
+    Fl_Button *btnStatsMore;
+    std::int64_t statsCursor{0};
+
+    Fl_Choice *statsModeChoice;
+    Fl_Choice *statsResultChoice;
+    Fl_Input *statsPidInput;
+    Fl_Int_Input *statsDaysInput;
+    HistoryQuery statsQuery;
+    bool statsFiltered=false;
+
+    static constexpr int historyPage=200;
 
     Fl_Window* codeWindow;
     Fl_Text_Buffer* codeBuffer;
@@ -1362,15 +7999,10 @@ private:
     Fl_Text_Buffer *gameBuffer;
 
 public:
-    GUI():game(nullptr), mainWindow(nullptr), ruleWindow(nullptr), 
+    GUI():root(fs::current_path()), repo(root/"CodeSnippets"), stats(root/"Statistics.dat"),
+        game(nullptr), mainWindow(nullptr), ruleWindow(nullptr), 
         statsWindow(nullptr), codeWindow(nullptr), addWindow(nullptr), gameWindow(nullptr)
     {
-        root=fs::current_path();
-
-        repo=CodeRepo(root/"CodeSnippets");
-
-        stats=StatisticsRepo(root/"Statistics.dat");
-
         // main menu
         mainWindow=new Fl_Window(200,240,"Code Wordle");
 
@@ -1393,11 +8025,7 @@ public:
 
     ~GUI()
     {
-        if(game)
-        {
-            delete game;
-            game=nullptr;
-        }
+        releaseGame();
 
         // only need to delete Window, when deleting them,
         // the other child controls(like buttons) will be deleted automatically
@@ -1542,6 +8170,30 @@ private:
         gui -> onRuleBack();
     }
     
+    static void cb_StatsMore(Fl_Widget*, void* userdata)
+    {
+        GUI *gui=static_cast<GUI*>(userdata);
+        gui -> onStatsMore();
+    }
+    
+    static void cb_StatsFilter(Fl_Widget*, void* userdata)
+    {
+        GUI *gui=static_cast<GUI*>(userdata);
+        gui -> onStatsFilter();
+    }
+    
+    static void cb_StatsClear(Fl_Widget*, void* userdata)
+    {
+        GUI *gui=static_cast<GUI*>(userdata);
+        gui -> onStatsClear();
+    }
+    
+    static void cb_StatsTop(Fl_Widget*, void* userdata)
+    {
+        GUI *gui=static_cast<GUI*>(userdata);
+        gui -> onStatsTop();
+    }
+    
     static void cb_StatsWindowClose(Fl_Widget*, void* userdata)
     {
         GUI *gui=static_cast<GUI*>(userdata);
@@ -1550,6 +8202,31 @@ private:
 
     void onPlay()
     {
+        // a game left unfinished when the app was closed or crashed
+        if(fs::exists(root/"Game.snap") && fl_choice("Resume the unfinished game?","New Game","Resume",nullptr) == 1)
+        {
+            releaseGame();
+
+            try
+            {
+                std::ifstream fin(root/"Game.snap",std::ios::binary);
+                std::string data((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+
+                gameId=sessions.restore(repo,stats,data);
+                game=sessions.get(gameId);
+            }
+            catch(const std::exception& e)
+            {
+                fl_alert("%s",e.what());
+                dropGame();
+                return;
+            }
+
+            autoGuesser.reset();
+            showGameWindow();
+            return;
+        }
+
         // prompt user to select game mode
         int mode=fl_choice("Select Game Mode:","Limited Guesses","Time Attack","Point");
         if(mode<0 || mode>2)
@@ -1559,41 +8236,45 @@ private:
         }
 
         // create appropriate game object based on selection
-        if(game)
-        { 
-            delete game; 
-            game=nullptr;
-        }
+        releaseGame();
 
         bool fuzzyAllowed=true;
         bool showProblemID=true;
         if(mode == 0)
         {   
             // Limited Guesses
-            game=new guessLimitedGame(repo,stats,fuzzyAllowed,showProblemID);
+            gameId=sessions.create<guessLimitedGame>(repo,stats,fuzzyAllowed,showProblemID);
         } 
         else 
             if(mode == 1)
             { 
                 // Time Attack
-                game=new timeAttackGame(repo,stats,fuzzyAllowed,showProblemID);
+                gameId=sessions.create<timeAttackGame>(repo,stats,fuzzyAllowed,showProblemID);
             } 
             else 
             { 
                 // Point
                 fuzzyAllowed=false;
                 showProblemID=false;
-                game=new pointGame(repo,stats,fuzzyAllowed,showProblemID);
+                gameId=sessions.create<pointGame>(repo,stats,fuzzyAllowed,showProblemID);
             }
 
+        game=sessions.get(gameId);
+
         if(!game->start())
         {
             fl_alert("There's no codesnippets");
-            delete game;
-            game=nullptr;
+            releaseGame();
             return;
         }
 
+        autoGuesser.reset();
+        saveGame();
+        showGameWindow();
+    }
+
+    void showGameWindow()
+    {
         if(!gameWindow)
         {
             gameWindow=new Fl_Window(800,600,"Game");
@@ -1716,23 +8397,54 @@ private:
     {
         if(!statsWindow)
         {
-            statsWindow=new Fl_Window(800,400,"Statistics");
+            statsWindow=new Fl_Window(800,440,"Statistics");
+
+            // history filters
+            statsModeChoice=new Fl_Choice(50,10,150,25,"Mode");
+            statsModeChoice -> add("Any|Limited Guesses|Time Attack|Point");
+            statsModeChoice -> value(0);
+
+            statsResultChoice=new Fl_Choice(260,10,70,25,"Result");
+            statsResultChoice -> add("Any|Win|Lose");
+            statsResultChoice -> value(0);
+
+            statsPidInput=new Fl_Input(400,10,90,25,"Code ID");
+            statsDaysInput=new Fl_Int_Input(560,10,50,25,"Last days");
+
+            Fl_Button *btnStatsFilter=new Fl_Button(620,8,80,30,"Filter");
+            Fl_Button *btnStatsClear =new Fl_Button(710,8,80,30,"Clear");
+
+            btnStatsFilter -> callback(cb_StatsFilter,this);
+            btnStatsClear -> callback(cb_StatsClear,this);
             
-            Fl_Text_Display *statsText=new Fl_Text_Display(10,10,780,340);
+            Fl_Text_Display *statsText=new Fl_Text_Display(10,50,780,340);
             
             statsBuffer=new Fl_Text_Buffer();
 
             statsText -> buffer(statsBuffer);
             statsText -> textfont(FL_COURIER);
 
-            Fl_Button *btnStatsBack=new Fl_Button(360,360,80,30,"Back");
+            btnStatsMore=new Fl_Button(260,400,80,30,"More");
+            Fl_Button *btnStatsTop=new Fl_Button(360,400,80,30,"Top");
+            Fl_Button *btnStatsBack=new Fl_Button(460,400,80,30,"Back");
 
+            btnStatsTop -> callback(cb_StatsTop,this);
+            btnStatsMore -> callback(cb_StatsMore,this);
             btnStatsBack -> callback(cb_StatsBack,this);
 
             statsWindow -> callback(cb_StatsWindowClose,this);
             statsWindow -> end();
         }
+
+        statsFiltered=false;
+        updateStatsDisplay();
         
+        mainWindow -> hide();
+        statsWindow -> show();
+    }
+
+    void updateStatsDisplay()
+    {
         std::vector<std::string> lines=stats.getStatistics();
         std::string content;
         for(auto& line:lines)
@@ -1744,9 +8456,67 @@ private:
         }
 
         statsBuffer -> text(content.c_str());
-        
-        mainWindow -> hide();
-        statsWindow -> show();
+
+        // only the newest games, the older ones are loaded by "More"
+        statsCursor=0;
+        btnStatsMore -> activate();
+        onStatsMore();
+    }
+
+    void onStatsMore()
+    {
+        std::vector<std::string> lines;
+        if(statsFiltered)
+            lines=stats.queryLines(statsQuery,historyPage);
+        else
+            lines=stats.getHistoryLines(statsCursor,historyPage);
+
+        statsCursor += lines.size();
+
+        std::string content;
+        for(auto& line:lines)
+            content += line+"\n";
+
+        statsBuffer -> append(content.c_str());
+
+        if(statsFiltered ?(int)lines.size()<historyPage:statsCursor >= stats.historySize())
+            btnStatsMore -> deactivate();
+    }
+
+    void onStatsFilter()
+    {
+        statsQuery=HistoryQuery();
+
+        // the choices list "Any" first, then the values in order
+        statsQuery.mode=statsModeChoice -> value()-1;
+        statsQuery.result=statsResultChoice -> value() == 0 ?-1:(statsResultChoice -> value() == 1 ?1:0);
+        statsQuery.pid=statsPidInput -> value();
+        statsQuery.lastDays(std::atoi(statsDaysInput -> value()));
+
+        statsFiltered=true;
+        updateStatsDisplay();
+    }
+
+    // the leaderboards replace the history, "More" stays off until it is shown again
+    void onStatsTop()
+    {
+        std::string content;
+        for(auto& line:stats.getLeaderboardLines())
+            content += line+"\n";
+
+        statsBuffer -> text(content.c_str());
+        btnStatsMore -> deactivate();
+    }
+
+    void onStatsClear()
+    {
+        statsModeChoice -> value(0);
+        statsResultChoice -> value(0);
+        statsPidInput -> value("");
+        statsDaysInput -> value("");
+
+        statsFiltered=false;
+        updateStatsDisplay();
     }
 
     void onExit() 
@@ -1806,7 +8576,12 @@ private:
         if(content.empty())
             codeBuffer -> text("Code not found\n");
         else
+        {
+            content += "\n"+stats.getSnippetSummary(pid)+"\n";
+            for(auto& line:stats.getLeaderboardLines(pid))
+                content += line+"\n";
             codeBuffer -> text(content.c_str());
+        }
     }
 
     void onAddEdit()
@@ -1917,6 +8692,7 @@ private:
             return;
         }
         
+        saveGame();
         updateGameDisplay(msg);
         
         guessInput -> take_focus();
@@ -1927,7 +8703,7 @@ private:
         if(!game)
             return;
         
-        std::string suggestion=autoGuesser.guess(game -> getMasked());
+        std::string suggestion=autoGuesser.guess(game -> getMasked(),game -> random());
         updateGameDisplay(std::vector<std::string>{suggestion});
         
         guessInput -> take_focus();
@@ -1974,26 +8750,158 @@ private:
         gameBuffer -> text(text.c_str());
     }
 
-    void cleanupGame()
+    void releaseGame()
     {
         if(game)
         {
-            delete game;
+            sessions.release(gameId);
             game=nullptr;
         }
+    }
+
+    // after every guess, so closing or killing the app loses nothing
+    void saveGame()
+    {
+        std::string data;
+        game -> snapshot(data);
+
+        try
+        {
+            std::ofstream fout(root/"Game.snap.tmp",std::ios::binary);
+            fout.write(data.data(),data.size());
+            fout.close();
+
+            fs::rename(root/"Game.snap.tmp",root/"Game.snap");
+        }
+        catch(const std::exception& e)
+        {
+            // the game goes on without it
+            std::cerr << e.what() << '\n';
+        }
+    }
+
+    void dropGame()
+    {
+        std::error_code ec;
+        fs::remove(root/"Game.snap",ec);
+    }
+
+    void cleanupGame()
+    {
+        releaseGame();
+        dropGame();
 
-        stats.saveToFile();
+        // the statistics are saved by the writer thread
     
         gameWindow -> hide();
         mainWindow -> show();
     }
 };
 
-int main()
+int main(int argc,char** argv)
 {
+    // "--convert-repo [sharded] [compressed] [retrain]" converts the snippets once, they're opened that way from then on
+    if(argc >= 2 && std::string(argv[1]) == "--convert-repo")
+    {
+        bool sharded=false;
+        bool compressed=false;
+        bool retrain=false;
+        for(int i=2;i<argc;i++)
+        {
+            std::string option=argv[i];
+            if(option == "sharded")
+                sharded=true;
+            else if(option == "compressed")
+                compressed=true;
+            else if(option == "retrain")
+                retrain=true;
+            else
+            {
+                std::cerr << "Unknown layout: " << option << '\n';
+                return 1;
+            }
+        }
+
+        try
+        {
+            CodeRepo repo(fs::current_path()/"CodeSnippets",sharded,compressed);
+            if(retrain)
+                repo.trainDictionary();
+
+            std::cout << "Snippets: " << repo.list().size() << '\n';
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // "--server <address>" runs the games headless, see GameServer for the protocol
+    if(argc >= 3 && std::string(argv[1]) == "--server")
+    {
+    #ifdef __linux__
+        try
+        {
+            GameServer server(fs::current_path(),argv[2]);
+            int port=server.port();
+            std::cout << "Listening on " << (port >= 0 ?"port "+std::to_string(port):std::string(argv[2])) << std::endl;
+
+            server.run();
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+
+        return 0;
+    #else
+        std::cerr << "The server is only available on Linux\n";
+        return 1;
+    #endif
+    }
+
+    // "--replay <file> [game]" plays the recorded games again, or shows one of them step by step
+    if(argc >= 3 && std::string(argv[1]) == "--replay")
+    {
+        try
+        {
+            CodeRepo repo(fs::current_path()/"CodeSnippets");
+            Replayer replayer(repo,argv[2]);
+
+            if(argc >= 4)
+            {
+                for(auto& line:replayer.trace(std::stoull(argv[3])))
+                    std::cout << line << '\n';
+
+                return 0;
+            }
+
+            auto summary=replayer.run();
+            std::cout << "Games: " << summary.games << ", Guesses: " << summary.guesses
+                      << ", Reveals: " << summary.reveals << '\n';
+            std::cout << "Diverged: " << summary.diverged << ", Missing: " << summary.missing
+                      << ", Corrupt: " << summary.corrupt << '\n';
+            std::cout << "Time: " << summary.seconds << "s, "
+                      << (summary.seconds>0 ?(std::uint64_t)(summary.guesses/summary.seconds):0) << " guesses/s\n";
+
+            return summary.diverged == 0 && summary.corrupt == 0 ?0:1;
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+
     //UI ui;
     //ui.mainloop();
     //return 0;
     GUI gui;
     return Fl::run();
 }
+
+#endif
@@ -0,0 +1,36 @@
+// shared by the tests: each test file includes main.cpp without its GUI and main(),
+// checks with CHECK and returns report() from its own main()
+#define CORDLE_NO_MAIN
+#include "../main.cpp"
+
+inline int failures=0;
+
+#define CHECK(cond) \
+    do \
+    { \
+        if(!(cond)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+            failures++; \
+        } \
+    } while(0)
+
+// an empty directory of its own for one test
+inline fs::path scratch(const std::string& name)
+{
+    auto dir=fs::temp_directory_path()/"cordle_tests"/name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    return dir;
+}
+
+inline int report(const char* name)
+{
+    if(failures)
+        std::cerr << name << ": " << failures << " failed\n";
+    else
+        std::cout << name << ": ok\n";
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#include "check.h"
+
+static std::mt19937 gen(28);
+
+static std::string randomBytes(std::size_t size)
+{
+    std::string data(size,'\0');
+    for(auto& c:data)
+        c=(char)gen();
+
+    return data;
+}
+
+static bool roundTrip(const std::string& data,const std::string& dict)
+{
+    try
+    {
+        return LzCodec::decompress(LzCodec::compress(data,dict),data.size(),dict) == data;
+    }
+    catch(const AppException&)
+    {
+        return false;
+    }
+}
+
+static void testRoundTrips()
+{
+    CHECK(roundTrip("",""));
+    CHECK(roundTrip("","int main()\n"));
+
+    // around the token and length boundaries, incompressible
+    for(std::size_t size:{1,2,3,4,5,14,15,16,254,255,269,270,271,4096,70000})
+    {
+        CHECK(roundTrip(randomBytes(size),""));
+        CHECK(roundTrip(randomBytes(size),randomBytes(100)));
+    }
+
+    // matches overlapping themselves, and match lengths far over 255
+    CHECK(roundTrip(std::string(100000,'a'),""));
+    CHECK(roundTrip(std::string(5,'a')+randomBytes(3)+std::string(300,'b'),""));
+
+    std::string pattern=randomBytes(7);
+    std::string repeated;
+    while(repeated.size()<20000)
+        repeated += pattern;
+    CHECK(roundTrip(repeated,""));
+    CHECK(LzCodec::compress(repeated,"").size()<repeated.size()/20);
+
+    // a repeat further back than an offset can reach
+    std::string far=randomBytes(1000);
+    far += randomBytes(70000)+far.substr(0,1000);
+    CHECK(roundTrip(far,""));
+
+    // only the end of a dictionary over MAX_DICT is used
+    auto big=randomBytes(LzCodec::MAX_DICT+5000);
+    CHECK(roundTrip(big.substr(big.size()-2000)+big.substr(0,2000),big));
+}
+
+static void testDictionary()
+{
+    std::vector<std::string> samples;
+    for(int i=0;i<50;i++)
+    {
+        auto n="n"+std::to_string(i);
+        samples.push_back("#include <iostream>\nusing namespace std;\nint main()\n{\n    int "+n+";\n"
+                          "    cin >> "+n+";\n    cout << "+n+" << endl;\n    return 0;\n}\n");
+    }
+
+    // snippets compressed against a dictionary trained on their siblings
+    auto dict=LzCodec::train(samples);
+    CHECK(!dict.empty());
+    CHECK(dict.size() <= LzCodec::MAX_DICT);
+
+    for(auto& sample:samples)
+    {
+        CHECK(roundTrip(sample,dict));
+        CHECK(LzCodec::compress(sample,dict).size()<LzCodec::compress(sample,"").size());
+    }
+}
+
+static void testDamaged()
+{
+    std::string data;
+    while(data.size()<20000)
+        data += "for(int i=0;i<n;i++)\n"+randomBytes(3);
+
+    // damaged data is reported, never read out of bounds; only the empty
+    // last token may be cut off without losing anything
+    auto packed=LzCodec::compress(data,"");
+    for(std::size_t cut=0;cut<packed.size();cut++)
+    {
+        try
+        {
+            CHECK(LzCodec::decompress(packed.substr(0,cut),data.size(),"") == data);
+            CHECK(cut == packed.size()-1);
+        }
+        catch(const AppException&)
+        {
+        }
+    }
+
+    for(int i=0;i<2000;i++)
+    {
+        try
+        {
+            std::size_t rawSize=gen()%512;
+            CHECK(LzCodec::decompress(randomBytes(1+gen()%64),rawSize,"").size() == rawSize);
+        }
+        catch(const AppException&)
+        {
+        }
+    }
+}
+
+int main()
+{
+    testRoundTrips();
+    testDictionary();
+    testDamaged();
+
+    return report("codec_test");
+}
@@ -0,0 +1,144 @@
+#include "check.h"
+#include <set>
+
+static void fill(CodeRepo& repo,int count)
+{
+    for(int i=0;i<count;i++)
+        repo.add("P"+std::to_string(i),{"int a"+std::to_string(i)+" = "+std::to_string(i*i)+";","return a * b + c;"});
+}
+
+static void testPuzzle()
+{
+    auto root=scratch("daily_puzzle");
+
+    {
+        CodeRepo empty(root/"Empty");
+        CHECK(!empty.daily(20000));
+    }
+
+    CodeRepo repo(root/"CodeSnippets");
+    fill(repo,20);
+
+    // built once a day, later starts share it
+    auto today=repo.daily(20000);
+    CHECK(today && today -> day == 20000 && today -> text);
+    CHECK(repo.daily(20000) == today);
+
+    // the day alone decides, another process with the same snippets agrees
+    CodeRepo other(root/"CodeSnippets");
+    auto same=other.daily(20000);
+    CHECK(same != today && same -> pid == today -> pid && same -> seed == today -> seed);
+
+    std::set<std::string> pids;
+    for(std::int64_t day=20000;day<20010;day++)
+        pids.insert(repo.daily(day) -> pid);
+    CHECK(pids.size()>1);
+
+    // an older day does not push the newest out of the cache
+    auto newest=repo.daily(20009);
+    repo.daily(19000);
+    CHECK(repo.daily(20009) == newest);
+
+    // a changed snippet may change the pick or its text, the puzzle is built again
+    repo.add(newest -> pid,{"int changed = 1;"});
+    auto rebuilt=repo.daily(20009);
+    CHECK(rebuilt != newest && rebuilt -> pid == newest -> pid);
+    CHECK(rebuilt -> text -> hash != newest -> text -> hash);
+}
+
+static void testGames()
+{
+    auto root=scratch("daily_games");
+    CodeRepo repo(root/"CodeSnippets");
+    fill(repo,20);
+    StatisticsStore store(root/"Profiles");
+
+    auto puzzle=repo.daily(GameRecord::today());
+
+    // two players get the same snippet and see the same reveals
+    auto play=[&](const std::string& user)
+    {
+        auto stats=store.get(user);
+        Game game(std::in_place_type<guessLimitedGame>,repo,*stats,true,true);
+        game.playDaily(puzzle);
+        CHECK(game.start());
+        CHECK(game.currentId() == puzzle -> pid);
+        CHECK(game.getSeed() == puzzle -> seed);
+
+        // the ID stays hidden, even though the mode was asked to show it
+        auto lines=game.getDisplayLines();
+        CHECK(lines[1].compare(0,8,"Problem:") != 0);
+        CHECK(game.makeGuess("P")[0] == "The problem ID stays hidden in the daily challenge");
+
+        for(int i=0;i<10;i++)
+            game.makeGuess("zzz");
+        auto masked=game.getMasked();
+
+        game.makeGuess("int");
+        game.makeGuess("return");
+        game.makeGuess("a"+puzzle -> pid.substr(1));
+        game.Lose();
+
+        return masked;
+    };
+
+    CHECK(play("alice") == play("bob"));
+
+    store.flush();
+    auto record=store.get("alice") -> getHistory(0,1)[0];
+    CHECK((record.flags&GameRecord::FLAG_DAILY) && !(record.flags&GameRecord::FLAG_PID));
+    CHECK(record.getPid() == puzzle -> pid);
+
+    // no puzzle when the repo is empty
+    CodeRepo empty(root/"Empty");
+    Game game(std::in_place_type<guessLimitedGame>,empty,*store.get("carol"),true,false);
+    game.playDaily(empty.daily(GameRecord::today()));
+    CHECK(!game.start());
+}
+
+static GameRecord dailyWin(int guesses,std::uint8_t flags,std::int64_t time)
+{
+    GameRecord record;
+    record.time=time;
+    record.mode=GameMode::GuessLimited;
+    record.result=1;
+    record.guesses=guesses;
+    record.seconds=100;
+    record.flags=flags;
+    record.setPid("P1");
+
+    return record;
+}
+
+static void testBoard()
+{
+    auto dir=scratch("daily_board");
+
+    LeaderboardTable table;
+    table.open(dir/"leaders");
+
+    // a game belongs to the day it started on, even when it ends after midnight
+    const std::int64_t midnight=20000*86400LL;
+    table.add(dailyWin(5,GameRecord::FLAG_DAILY,midnight+50),"alice");
+    table.add(dailyWin(3,GameRecord::FLAG_DAILY,midnight+200),"bob");
+    table.add(dailyWin(2,0,midnight+300),"carol");                                         // not a daily game
+    table.add(dailyWin(1,GameRecord::FLAG_DAILY|GameRecord::FLAG_PID,midnight+400),"dave"); // saw the ID
+
+    auto before=table.top(LeaderboardTable::GUESSES,LeaderboardTable::dailyKey(19999));
+    CHECK(before.size() == 1 && before[0].getUser() == "alice");
+
+    auto day=table.top(LeaderboardTable::GUESSES,LeaderboardTable::dailyKey(20000));
+    CHECK(day.size() == 1 && day[0].getUser() == "bob");
+
+    // every game is on the pid board as before
+    CHECK(table.top(LeaderboardTable::GUESSES,"P1").size() == 4);
+}
+
+int main()
+{
+    testPuzzle();
+    testGames();
+    testBoard();
+
+    return report("daily_test");
+}
@@ -0,0 +1,180 @@
+#include "check.h"
+
+struct Fixture
+{
+    fs::path root;
+    CodeRepo repo;
+    StatisticsRepo stats;
+
+    Fixture(const std::string& name):root(scratch(name)),repo(root/"CodeSnippets"),stats(root/"Statistics.dat")
+    {
+        repo.add("P1",{"int main"});
+    }
+
+    GameRecord last()
+    {
+        stats.flush();
+        return stats.getHistory(0,1)[0];
+    }
+};
+
+static void testGuessLimit()
+{
+    Fixture f("game_guesses");
+
+    guessLimitedGame game(f.repo,f.stats,true,false);
+    CHECK(game.start());
+    CHECK(game.getGameInfo()[0] == "Guesses: 0/30");
+
+    CHECK(game.makeGuess("ab")[0] == "Guess must be at least 3 chars");
+    CHECK(game.guessCount() == 0);
+
+    // a character is revealed every 5 guesses
+    auto before=game.getMasked();
+    for(int i=0;i<4;i++)
+        game.makeGuess("zzz");
+    CHECK(game.getMasked() == before);
+    game.makeGuess("zzz");
+    CHECK(game.getMasked() != before);
+
+    for(int i=5;i<29;i++)
+        game.makeGuess("zzz");
+    CHECK(!game.isOver());
+    game.makeGuess("zzz");
+    CHECK(game.isOver());
+
+    CHECK(game.Lose() == "You lose. You have used 30 guesses.");
+
+    auto record=f.last();
+    CHECK(record.mode == GameMode::GuessLimited && record.limit == 30 && record.result == 0);
+    CHECK(record.guesses == 30 && record.getPid() == "P1");
+}
+
+static void testTimeLimit()
+{
+    Fixture f("game_time");
+
+    timeAttackGame game(f.repo,f.stats,true,false);
+    CHECK(game.start());
+    CHECK(game.getGameInfo()[0] == "Time: 0s/60s");
+    CHECK(!game.isOver());
+
+    game.makeGuess("int");
+    game.makeGuess("main");
+    CHECK(game.isFinished());
+    CHECK(game.Win() == "You win! You only used 0 seconds!");
+
+    auto record=f.last();
+    CHECK(record.mode == GameMode::TimeAttack && record.limit == 60 && record.result == 1);
+}
+
+static void testPoints()
+{
+    Fixture f("game_points");
+
+    {
+        pointGame game(f.repo,f.stats,false,false);
+        CHECK(game.start());
+        CHECK(!game.isOver());
+
+        // all 7 characters in 2 guesses: (500*7*7/7-2*100)*1.5
+        game.makeGuess("int");
+        game.makeGuess("main");
+        CHECK(game.isFinished());
+        CHECK(game.Win() == "You achieved 4950.000000 points!");
+        CHECK(f.last().points == 4950);
+    }
+
+    {
+        // showing the problem halves the points, and a point game can not be lost
+        pointGame game(f.repo,f.stats,false,false);
+        CHECK(game.start());
+        CHECK(game.makeGuess("P")[0] == "PID showing enabled");
+        CHECK(game.getDisplayLines()[1] == "Problem: www.luogu.com.cn/problem/P1");
+
+        game.makeGuess("int");
+        CHECK(game.Lose() == "You achieved "+std::to_string((500*3*3/7.0-100)*0.5)+" points!");
+
+        auto record=f.last();
+        CHECK(record.mode == GameMode::Point && record.result == 1 && (record.flags&GameRecord::FLAG_PID));
+    }
+
+    bool thrown=false;
+    try
+    {
+        pointGame game(f.repo,f.stats,false,false,std::pmr::get_default_resource(),100,500,0.5);
+    }
+    catch(const AppException&)
+    {
+        thrown=true;
+    }
+    CHECK(thrown);
+}
+
+static void testVariant()
+{
+    Fixture f("game_variant");
+
+    // the modes behind one Game behave as the modes themselves
+    Game game(std::in_place_type<guessLimitedGame>,f.repo,f.stats,true,false);
+    CHECK(game.start());
+    CHECK(game.currentId() == "P1");
+    CHECK(game.getGameInfo()[0] == "Guesses: 0/30");
+
+    game.makeGuess("int");
+    CHECK(game.guessCount() == 1 && !game.isFinished());
+    game.makeGuess("main");
+    CHECK(game.isFinished());
+    CHECK(game.Win() == "You win! You only used 2 guesses!");
+}
+
+static void testSeeds()
+{
+    auto root=scratch("game_seeds");
+    CodeRepo repo(root/"CodeSnippets");
+    for(int i=0;i<20;i++)
+        repo.add("P"+std::to_string(i),{"int a"+std::to_string(i)+" = "+std::to_string(i*i)+";","return a;"});
+    StatisticsRepo stats(root/"Statistics.dat");
+
+    // the same draws on every platform
+    GameRng rng(42);
+    GameRng again(42);
+    bool same=true;
+    for(int i=0;i<1000;i++)
+        same=same && rng.next() == again.next();
+    CHECK(same);
+
+    int counts[10]{};
+    for(int i=0;i<10000;i++)
+        counts[rng.below(10)]++;
+    for(int c:counts)
+        CHECK(c>800 && c<1200);
+
+    // a game played again from its seed picks the same snippet and reveals the same characters
+    auto play=[&](std::uint64_t seed)
+    {
+        Game game(std::in_place_type<guessLimitedGame>,repo,stats,true,false);
+        game.setSeed(seed);
+        game.start();
+        for(int i=0;i<10;i++)
+            game.makeGuess("zzz");
+
+        auto lines=game.getMasked();
+        lines.push_back(game.currentId());
+        return lines;
+    };
+
+    CHECK(play(7) == play(7));
+    CHECK(play(7) != play(8) || play(7) != play(9));
+}
+
+int main()
+{
+    testGuessLimit();
+    testTimeLimit();
+    testPoints();
+    testVariant();
+    testSeeds();
+
+    return report("game_test");
+}
@@ -0,0 +1,288 @@
+#include "check.h"
+
+static GameRecord makeRecord(GameMode mode,bool win,double points,const std::string& pid)
+{
+    GameRecord record;
+    record.time=1700000000;
+    record.mode=mode;
+    record.result=win ?1:0;
+    record.points=points;
+    record.setPid(pid);
+
+    return record;
+}
+
+static void testSharedFile()
+{
+    auto dir=scratch("shared_file");
+    auto path=dir/"Statistics.dat";
+
+    // two mappings of one file, as two processes would have
+    SharedHistory first,second;
+    first.open(path);
+    second.open(path);
+
+    CHECK(first.append(makeRecord(GameMode::Point,false,12.5,"a")));
+    CHECK(second.append(makeRecord(GameMode::GuessLimited,true,0,"b")));
+
+    CHECK(first.committed() == 2 && second.committed() == 2);
+
+    GameRecord record;
+    CHECK(first.read(1,record) && record.getPid() == "b" && record.result == 1);
+    CHECK(second.read(0,record) && record.getPid() == "a" && record.points == 12.5);
+
+    auto c=second.counters();
+    CHECK(c.games[(int)GameMode::Point] == 1 && c.games[(int)GameMode::GuessLimited] == 1);
+    CHECK(c.wins[(int)GameMode::GuessLimited] == 1 && c.points == 12.5);
+}
+
+static void testConcurrentAppends()
+{
+    auto dir=scratch("concurrent_appends");
+    auto path=dir/"Statistics.dat";
+
+    {
+        SharedHistory history;
+        history.open(path);
+    }
+
+    // crosses into a second segment
+    constexpr int THREADS=4;
+    constexpr int EACH=5000;
+
+    std::vector<std::thread> threads;
+    for(int t=0;t<THREADS;t++)
+        threads.emplace_back([&,t]
+        {
+            SharedHistory history;
+            history.open(path);
+            for(int i=0;i<EACH;i++)
+                history.append(makeRecord(GameMode::Point,false,1,"t"+std::to_string(t)));
+        });
+
+    for(auto& thread:threads)
+        thread.join();
+
+    SharedHistory history;
+    history.open(path);
+    CHECK(history.committed() == THREADS*EACH);
+
+    int seen[THREADS]{};
+    for(std::uint64_t i=0;i<history.committed();i++)
+    {
+        GameRecord record;
+        if(history.read(i,record))
+            seen[record.getPid()[1]-'0']++;
+    }
+
+    for(int t=0;t<THREADS;t++)
+        CHECK(seen[t] == EACH);
+
+    auto c=history.counters();
+    CHECK(c.games[(int)GameMode::Point] == THREADS*EACH);
+    CHECK(c.points == THREADS*EACH);
+}
+
+static void testRebuild()
+{
+    auto dir=scratch("rebuild");
+    auto path=dir/"Statistics.dat";
+
+    SharedHistory::Counters counters;
+    counters.games[(int)GameMode::TimeAttack]=7;
+    counters.wins[(int)GameMode::TimeAttack]=3;
+
+    std::vector<GameRecord> records;
+    for(int i=0;i<7;i++)
+        records.push_back(makeRecord(GameMode::TimeAttack,i<3,0,"r"+std::to_string(i)));
+
+    SharedHistory history;
+    history.rebuild(path,records,counters);
+
+    CHECK(SharedHistory::version(path) == 2);
+    CHECK(history.committed() == 7);
+
+    GameRecord record;
+    CHECK(history.read(6,record) && record.getPid() == "r6");
+    CHECK(history.counters().wins[(int)GameMode::TimeAttack] == 3);
+
+    // a rebuild with fewer records drops the old segments
+    history.rebuild(path,{},SharedHistory::Counters());
+    CHECK(history.committed() == 0);
+    CHECK(history.counters().games[(int)GameMode::TimeAttack] == 0);
+}
+
+static void testTwoRepos()
+{
+    auto dir=scratch("two_repos");
+    auto path=dir/"Statistics.dat";
+
+    StatisticsRepo first(path);
+    StatisticsRepo second(path);
+
+    for(int i=0;i<20;i++)
+        first.addGame(makeRecord(GameMode::Point,false,i,"x"));
+    first.flush();
+
+    // the history and the counters are shared at once
+    CHECK(second.historySize() == 20);
+    CHECK(second.getStatistics()[3] == "Point Games: 20");
+
+    // the aggregates are caught up by the writer thread of the reading repo
+    SnippetAggregate a{};
+    second.getSnippetStats("x",a);
+    second.flush();
+    CHECK(second.getSnippetStats("x",a));
+    CHECK(a.plays == 20);
+
+    // games of both repos end up in one history
+    second.addGame(makeRecord(GameMode::Point,true,100,"y"));
+    second.flush();
+    CHECK(first.historySize() == 21);
+}
+
+static void testVersion1()
+{
+    auto dir=scratch("version1");
+    auto path=dir/"Statistics.dat";
+
+    // the single-process layout: a 96-byte header, then the records
+    char header[96]{};
+    std::memcpy(header,"CWST",4);
+    LittleEndian::put(header+4,1,4);
+    LittleEndian::put(header+8,96,4);
+    LittleEndian::put(header+12,SharedHistory::RECORD_SIZE,4);
+    LittleEndian::put(header+16,2,8);
+    LittleEndian::put(header+32+(int)GameMode::Point*8,2,8);
+    LittleEndian::putDouble(header+72,30);
+
+    {
+        std::ofstream fout(path,std::ios::binary);
+        fout.write(header,sizeof(header));
+
+        char buf[SharedHistory::RECORD_SIZE];
+        for(double points:{10.0,20.0})
+        {
+            SharedHistory::encodeRecord(makeRecord(GameMode::Point,false,points,"v"),buf);
+            fout.write(buf,sizeof(buf));
+        }
+    }
+
+    StatisticsRepo stats(path);
+    CHECK(fs::exists(path.string()+".v1"));
+    CHECK(stats.historySize() == 2);
+    CHECK(stats.getHistory(0,1)[0].points == 20);
+    CHECK(stats.getStatistics()[4] == "Average Points: 15.000000");
+}
+
+static void testCompaction()
+{
+    auto dir=scratch("compaction");
+    auto path=dir/"Statistics.dat";
+
+    // one more segment than is retained, a game a minute up to now
+    const std::uint64_t total=9*SharedHistory::SEGMENT_RECORDS+100;
+    std::int64_t now=std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch()).count();
+
+    {
+        SharedHistory history;
+        history.open(path);
+        for(std::uint64_t i=0;i<total;i++)
+        {
+            auto record=makeRecord(GameMode::Point,i%2 == 0,1,"c"+std::to_string(i%50));
+            record.time=now-(std::int64_t)(total-i)*60;
+            history.append(record);
+        }
+    }
+
+    // the games of c1, and those of them still kept in detail
+    std::uint64_t plays=0,detailed=0;
+    for(std::uint64_t i=0;i<total;i++)
+        if(i%50 == 1)
+        {
+            plays++;
+            detailed += i >= SharedHistory::SEGMENT_RECORDS;
+        }
+
+    {
+        // the compactor runs right after the repo was opened
+        StatisticsRepo stats(path);
+        for(int i=0;i<200 && stats.historySize() == (std::int64_t)total;i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        CHECK(stats.historySize() == (std::int64_t)(total-SharedHistory::SEGMENT_RECORDS));
+        CHECK(!fs::exists(path.string()+".seg000000"));
+        CHECK(stats.getHistory(0,1)[0].time == now-60);
+        CHECK(stats.getStatistics()[3] == "Point Games: "+std::to_string(total));
+
+        // the daily totals cover the compacted and the detailed records
+        std::int64_t games=0;
+        for(auto& day:stats.getDailyStats(200))
+            games += day.games[(int)GameMode::Point];
+        CHECK(games == (std::int64_t)total);
+
+        // the queries only search the records kept in detail
+        HistoryQuery q;
+        q.pid="c1";
+        CHECK(stats.query(q,1000000).size() == detailed);
+    }
+
+    // lost aggregates come back from the rollup and the retained history
+    fs::remove(path.string()+".snippets");
+    fs::remove(path.string()+".sketches");
+
+    StatisticsRepo stats(path);
+    SnippetAggregate a{};
+    CHECK(stats.getSnippetStats("c1",a));
+    CHECK(a.plays == plays);
+
+    SketchStore::Block block{};
+    CHECK(stats.getSketches((std::uint32_t)GameMode::Point,block));
+    CHECK(block.metric[SketchStore::POINTS].count() == total);
+}
+
+static void testDailyTable()
+{
+    auto dir=scratch("daily");
+
+    CHECK(GameRecord::dayOf(0) == 0);
+    CHECK(GameRecord::dayOf(86399) == 0);
+    CHECK(GameRecord::dayOf(-1) == -1);
+    CHECK(GameRecord::dayOf(-86400) == -1);
+
+    // out of order, and past the first 256 days
+    DailyRollupTable daily;
+    daily.open(dir/"daily");
+    for(int d=599;d >= 0;d--)
+    {
+        auto record=makeRecord(GameMode::GuessLimited,d%2 == 0,0,"d");
+        record.time=(std::int64_t)d*86400+100;
+        record.guesses=d;
+        daily.add(record);
+    }
+
+    auto days=daily.get(100,299);
+    CHECK(days.size() == 200);
+    CHECK(days.front().day == 100 && days.back().day == 299);
+    CHECK(days[1].games[(int)GameMode::GuessLimited] == 1 && days[1].wins[(int)GameMode::GuessLimited] == 0);
+    CHECK(days[1].guesses == 101);
+    CHECK(daily.appliedRecords() == 600);
+
+    DailyRollupTable reopened;
+    reopened.open(dir/"daily");
+    CHECK(reopened.get(0,1000).size() == 600);
+}
+
+int main()
+{
+    testSharedFile();
+    testConcurrentAppends();
+    testRebuild();
+    testTwoRepos();
+    testVersion1();
+    testCompaction();
+    testDailyTable();
+
+    return report("history_test");
+}
@@ -0,0 +1,102 @@
+#include "check.h"
+#include <set>
+
+static void testPool()
+{
+    ThreadPool pool(4);
+    CHECK(pool.size() == 4);
+
+    std::atomic<int> count{0};
+    for(int i=0;i<1000;i++)
+        pool.submit([&]{count++;});
+    pool.wait();
+    CHECK(count == 1000);
+
+    // a worker submits to its own queue, the others steal from it
+    std::mutex mtx;
+    std::set<std::thread::id> threads;
+    pool.submit([&]
+    {
+        for(int i=0;i<200;i++)
+            pool.submit([&]
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+                std::lock_guard<std::mutex> lock(mtx);
+                threads.insert(std::this_thread::get_id());
+            });
+    });
+    pool.wait();
+    CHECK(threads.size()>1);
+
+    // a blocked worker does not hold up the tasks queued behind it
+    std::atomic<bool> release{false};
+    std::atomic<int> after{0};
+    pool.submit([&]
+    {
+        while(!release)
+            std::this_thread::yield();
+    });
+    for(int i=0;i<100;i++)
+        pool.submit([&]{after++;});
+
+    for(int i=0;i<1000 && after<100;i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK(after == 100);
+
+    release=true;
+    pool.wait();
+}
+
+static void testStrands()
+{
+    ThreadPool pool(4);
+
+    constexpr int STRANDS=8;
+    constexpr int TASKS=500;
+
+    // each strand runs its tasks in order and never two at once
+    std::vector<std::unique_ptr<Strand> > strands;
+    std::vector<std::vector<int> > order(STRANDS);
+    std::vector<std::atomic<int> > running(STRANDS);
+    std::atomic<bool> overlapped{false};
+
+    for(int s=0;s<STRANDS;s++)
+        strands.push_back(std::make_unique<Strand>(pool));
+
+    std::vector<std::thread> posters;
+    for(int s=0;s<STRANDS;s++)
+        posters.emplace_back([&,s]
+        {
+            for(int i=0;i<TASKS;i++)
+                strands[s] -> post([&,s,i]
+                {
+                    if(running[s]++ != 0)
+                        overlapped=true;
+
+                    order[s].push_back(i);
+                    running[s]--;
+                });
+        });
+
+    for(auto& poster:posters)
+        poster.join();
+    pool.wait();
+
+    CHECK(!overlapped);
+    for(int s=0;s<STRANDS;s++)
+    {
+        bool inOrder=(int)order[s].size() == TASKS;
+        for(int i=0;inOrder && i<TASKS;i++)
+            inOrder=order[s][i] == i;
+        CHECK(inOrder);
+    }
+}
+
+int main()
+{
+    testPool();
+    testStrands();
+
+    return report("pool_test");
+}
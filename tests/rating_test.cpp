@@ -0,0 +1,193 @@
+#include "check.h"
+
+static GameRecord makeRecord(bool win,const std::string& pid,std::int64_t time=1700000000)
+{
+    GameRecord record;
+    record.time=time;
+    record.mode=GameMode::GuessLimited;
+    record.result=win ?1:0;
+    record.guesses=5;
+    record.setPid(pid);
+
+    return record;
+}
+
+static bool near(double a,double b,double tolerance=0.5)
+{
+    return std::abs(a-b) <= tolerance;
+}
+
+static void testGlicko()
+{
+    auto dir=scratch("rating_glicko");
+    RatingTable table;
+    table.open(dir/"ratings");
+
+    auto fresh=table.get(RatingTable::PLAYER,"alice");
+    CHECK(fresh.games == 0 && fresh.rating == 1500 && fresh.deviation == 350);
+
+    // two unrated sides, the worked Glicko-1 numbers
+    table.add(makeRecord(true,"P1"),"alice");
+
+    auto alice=table.get(RatingTable::PLAYER,"alice");
+    auto snippet=table.get(RatingTable::SNIPPET,"P1");
+    CHECK(alice.games == 1 && snippet.games == 1);
+    CHECK(near(alice.rating,1662.3) && near(alice.deviation,290.2));
+    CHECK(near(snippet.rating,1337.7) && near(snippet.deviation,290.2));
+
+    // a player and a snippet of the same name are two entries
+    CHECK(table.get(RatingTable::SNIPPET,"alice").games == 0);
+
+    // the deviation never drops under its floor
+    for(int i=0;i<200;i++)
+        table.add(makeRecord(i%2 == 0,"P2"),"bob");
+    CHECK(table.get(RatingTable::PLAYER,"bob").deviation == RatingTable::MIN_DEVIATION);
+
+    // it grows back while idle, so a game a year later moves the rating more
+    auto before=table.get(RatingTable::PLAYER,"bob");
+    table.add(makeRecord(true,"P2",1700000000+365*86400),"bob");
+    auto after=table.get(RatingTable::PLAYER,"bob");
+
+    RatingTable other;
+    other.open(dir/"other");
+    for(int i=0;i<200;i++)
+        other.add(makeRecord(i%2 == 0,"P2"),"bob");
+    other.add(makeRecord(true,"P2",1700000001),"bob");
+
+    CHECK(after.rating-before.rating>other.get(RatingTable::PLAYER,"bob").rating-before.rating);
+    CHECK(table.appliedRecords() == 202);
+}
+
+static void testGrowthAndReopen()
+{
+    auto dir=scratch("rating_growth");
+
+    {
+        RatingTable table;
+        table.open(dir/"ratings");
+        for(int i=0;i<3000;i++)
+            table.add(makeRecord(false,"s"+std::to_string(i)),"u"+std::to_string(i%7));
+    }
+
+    RatingTable table;
+    table.open(dir/"ratings");
+    CHECK(table.appliedRecords() == 3000);
+
+    int rated=0;
+    for(int i=0;i<3000;i++)
+    {
+        auto entry=table.get(RatingTable::SNIPPET,"s"+std::to_string(i));
+        rated += entry.games == 1 && entry.rating>1500;
+    }
+    CHECK(rated == 3000);
+
+    std::uint32_t games=0;
+    for(int u=0;u<7;u++)
+        games += table.get(RatingTable::PLAYER,"u"+std::to_string(u)).games;
+    CHECK(games == 3000);
+
+    std::vector<RatingEntry> snippets;
+    auto player=table.getPick("u0",{"s0","unknown"},snippets);
+    CHECK(player.games == table.get(RatingTable::PLAYER,"u0").games);
+    CHECK(snippets.size() == 2 && snippets[0].games == 1 && snippets[1].games == 0);
+}
+
+static void testRepoRatings()
+{
+    auto dir=scratch("rating_repo");
+    auto path=dir/"Statistics.dat";
+
+    // past the retained segments, so part of the games are only in the rollup
+    const std::uint64_t total=9*SharedHistory::SEGMENT_RECORDS+10;
+    {
+        SharedHistory history;
+        history.open(path);
+        for(std::uint64_t i=0;i<total;i++)
+            history.append(makeRecord(i%3 != 0,"p"+std::to_string(i%5)));
+    }
+
+    std::uint32_t games;
+    double rating;
+    {
+        StatisticsRepo stats(path);
+        stats.flush();
+
+        auto player=stats.getPlayerRating();
+        games=player.games;
+        rating=player.rating;
+        CHECK(games == total);
+    }
+
+    // lost ratings come back from the rollup, not from the retained history alone
+    fs::remove(path.string()+".ratings");
+
+    StatisticsRepo stats(path);
+    stats.getPlayerRating();
+    stats.flush();
+
+    auto player=stats.getPlayerRating();
+    CHECK(player.games == games);
+    CHECK(player.rating == rating);
+
+    std::vector<RatingEntry> snippets;
+    CHECK(stats.getPickRatings({"p0","p1"},snippets).games == games);
+    CHECK(snippets.size() == 2 && snippets[0].games+snippets[1].games == (total+4)/5+(total+3)/5);
+}
+
+static void testPicks()
+{
+    auto dir=scratch("rating_picks");
+
+    CodeRepo repo(dir/"pids");
+    repo.add("easy",{"int easy;"});
+    repo.add("fresh",{"int fresh;"});
+
+    StatisticsRepo stats(dir/"Statistics.dat");
+    for(int i=0;i<30;i++)
+        stats.addGame(makeRecord(true,"easy"));
+    stats.flush();
+
+    // the player is far above the easy snippet now, so an unplayed one is closer
+    CHECK(stats.getPlayerRating().rating-stats.getSnippetRating("easy").rating>400);
+
+    int fresh=0;
+    for(int i=0;i<50;i++)
+    {
+        guessLimitedGame game(repo,stats,true,false);
+        CHECK(game.start());
+        fresh += game.currentId() == "fresh";
+    }
+
+    // only a draw of eight easy candidates picks it, 1 in 256
+    CHECK(fresh >= 45);
+}
+
+static void testGlobalRatings()
+{
+    auto dir=scratch("rating_global");
+    StatisticsStore store(dir);
+
+    for(int i=0;i<10;i++)
+    {
+        store.get("alice") -> addGame(makeRecord(true,"P1"));
+        store.get("bob") -> addGame(makeRecord(false,"P1"));
+    }
+    store.flush();
+
+    // the users are rated against everyone's games
+    auto alice=store.get("alice");
+    CHECK(alice -> getPlayerRating().rating>1500);
+    CHECK(store.get("bob") -> getPlayerRating().rating<1500);
+    CHECK(alice -> getSnippetRating("P1").games == 20);
+}
+
+int main()
+{
+    testGlicko();
+    testGrowthAndReopen();
+    testRepoRatings();
+    testPicks();
+    testGlobalRatings();
+
+    return report("rating_test");
+}
@@ -0,0 +1,215 @@
+#include "check.h"
+
+static void testVarints()
+{
+    std::string out;
+    const std::vector<std::uint64_t> values={0,1,127,128,300,16383,16384,1ull<<35,~0ull};
+    for(auto v:values)
+        ReplayLog::putVarint(out,v);
+
+    const char* p=out.data();
+    const char* end=p+out.size();
+    bool same=true;
+    for(auto v:values)
+    {
+        std::uint64_t read;
+        same=same && ReplayLog::getVarint(p,end,read) && read == v;
+    }
+    CHECK(same);
+    CHECK(p == end);
+
+    // cut off in the middle
+    std::string cut;
+    ReplayLog::putVarint(cut,1ull<<40);
+    cut.pop_back();
+    p=cut.data();
+    std::uint64_t read;
+    CHECK(!ReplayLog::getVarint(p,cut.data()+cut.size(),read));
+}
+
+struct Fixture
+{
+    fs::path root;
+    CodeRepo repo;
+    StatisticsRepo stats;
+
+    Fixture(const std::string& name):root(scratch(name)),repo(root/"CodeSnippets"),stats(root/"Statistics.dat")
+    {
+        for(int i=0;i<10;i++)
+            repo.add("P"+std::to_string(i),{"int v"+std::to_string(i)+" = "+std::to_string(i*7)+";","return v;"});
+    }
+
+    template<class Mode>
+    void play(ReplayWriter& writer,std::uint64_t seed,bool fuzzy)
+    {
+        Game game(std::in_place_type<Mode>,repo,stats,fuzzy,false);
+        game.record(true);
+        game.setSeed(seed);
+        CHECK(game.start());
+
+        for(const char* guess:{"int","zzz","return","zzz","zzz","zzz","zzz"})
+            game.makeGuess(guess);
+        if(!fuzzy)
+            game.makeGuess("F");
+
+        game.Lose();
+        writer.write(game.replayLog());
+    }
+
+    // plays games of every mode into the replay file
+    void record(int games)
+    {
+        ReplayWriter writer(root/"Replays.dat");
+
+        for(int g=0;g<games;g++)
+        {
+            if(g%3 == 0)
+                play<guessLimitedGame>(writer,1000+g,true);
+            else if(g%3 == 1)
+                play<timeAttackGame>(writer,1000+g,true);
+            else
+                play<pointGame>(writer,1000+g,false);
+        }
+    }
+};
+
+// the times in a trace depend on how fast the games were played
+static bool endsWith(const std::string& text,const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size()-suffix.size(),suffix.size(),suffix) == 0;
+}
+
+static void testReplay()
+{
+    Fixture f("replay_games");
+    f.record(30);
+
+    Replayer replayer(f.repo,f.root/"Replays.dat");
+    CHECK(replayer.size() == 30);
+
+    // the same on one thread and on many
+    for(unsigned threads:{1u,4u})
+    {
+        auto summary=replayer.run(threads);
+        CHECK(summary.games == 30);
+        CHECK(summary.guesses == 30*7);
+        CHECK(summary.reveals>0);
+        CHECK(summary.diverged == 0 && summary.missing == 0 && summary.corrupt == 0);
+    }
+
+    // a second writer appends after the first
+    f.record(3);
+    CHECK(Replayer(f.repo,f.root/"Replays.dat").size() == 33);
+
+    auto lines=replayer.trace(0);
+    CHECK(lines[0] == "Mode: G, Seed: 1000, Problem: "+lines[0].substr(lines[0].rfind(' ')+1));
+    CHECK(endsWith(lines[1],"ms Guess \"int\": 1 matches"));
+    CHECK(endsWith(lines[2],"ms Guess \"zzz\": 0 matches"));
+
+    // the third game is a point game that turns fuzzy matching on
+    lines=replayer.trace(2);
+    CHECK(lines[0].compare(0,8,"Mode: P,") == 0);
+    CHECK(endsWith(lines[8],"ms Enabled F") && endsWith(lines[9],"ms Lose"));
+
+    bool thrown=false;
+    try
+    {
+        replayer.trace(100);
+    }
+    catch(const AppException&)
+    {
+        thrown=true;
+    }
+    CHECK(thrown);
+}
+
+// the offset of the first log and of its first event
+static std::pair<std::size_t,std::size_t> firstLog(const std::string& data)
+{
+    const char* begin=data.data();
+    const char* end=begin+data.size();
+    const char* p=begin+ReplayLog::MAGIC_SIZE;
+
+    std::uint64_t size,seed,pidSize;
+    ReplayLog::getVarint(p,end,size);
+    std::size_t log=p-begin;
+
+    p += 2;
+    ReplayLog::getVarint(p,end,seed);
+    ReplayLog::getVarint(p,end,pidSize);
+
+    return {log,p+pidSize-begin};
+}
+
+static void testDamage()
+{
+    Fixture f("replay_damage");
+    f.record(5);
+    auto path=f.root/"Replays.dat";
+
+    std::string data;
+    {
+        std::ifstream fin(path,std::ios::binary);
+        data.assign((std::istreambuf_iterator<char>(fin)),std::istreambuf_iterator<char>());
+    }
+
+    auto rewrite=[&](const std::string& text)
+    {
+        std::ofstream fout(path,std::ios::binary|std::ios::trunc);
+        fout << text;
+    };
+
+    // a log cut off by a crash is dropped, the ones before it are kept
+    rewrite(data.substr(0,data.size()-3));
+    CHECK(Replayer(f.repo,path).size() == 4);
+
+    // the last byte of the first log is the guessed count of its end
+    auto offsets=firstLog(data);
+    std::uint64_t size;
+    const char* p=data.data()+ReplayLog::MAGIC_SIZE;
+    ReplayLog::getVarint(p,data.data()+data.size(),size);
+
+    std::string bad=data;
+    bad[offsets.first+size-1]=0x7f;
+    rewrite(bad);
+    auto summary=Replayer(f.repo,path).run(2);
+    CHECK(summary.games == 5 && summary.diverged == 1 && summary.corrupt == 0);
+
+    // an event of an unknown type
+    bad=data;
+    bad[offsets.second]=9;
+    rewrite(bad);
+    summary=Replayer(f.repo,path).run(2);
+    CHECK(summary.games == 5 && summary.corrupt == 1 && summary.diverged == 0);
+
+    auto lines=Replayer(f.repo,path).trace(0);
+    CHECK(lines.back() == "The log is corrupt");
+
+    // the snippets are not in this repo
+    rewrite(data);
+    CodeRepo empty(f.root/"Empty");
+    summary=Replayer(empty,path).run(2);
+    CHECK(summary.games == 5 && summary.missing == 5);
+
+    // not a replay file
+    rewrite("hello");
+    bool thrown=false;
+    try
+    {
+        Replayer replayer(f.repo,path);
+    }
+    catch(const AppException&)
+    {
+        thrown=true;
+    }
+    CHECK(thrown);
+}
+
+int main()
+{
+    testVarints();
+    testReplay();
+    testDamage();
+
+    return report("replay_test");
+}
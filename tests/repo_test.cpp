@@ -0,0 +1,251 @@
+#include "check.h"
+
+static std::vector<std::string> sorted(std::vector<std::string> ids)
+{
+    std::sort(ids.begin(),ids.end());
+    return ids;
+}
+
+static void testFlat()
+{
+    auto dir=scratch("flat");
+
+    CodeRepo repo(dir);
+    repo.add("b",{"int b;"});
+    repo.add("a",{"int a;"});
+
+    CHECK(repo.list() == std::vector<std::string>({"a","b"}));
+    CHECK(fs::exists(dir/"a.txt"));
+    CHECK(repo.read("a") == "int a;\n");
+
+    CHECK(repo.remove("a"));
+    CHECK(!repo.remove("a"));
+    CHECK(repo.list() == std::vector<std::string>({"b"}));
+}
+
+static void testConvert()
+{
+    auto dir=scratch("convert");
+
+    {
+        CodeRepo flat(dir);
+        for(int i=0;i<20;i++)
+            flat.add("p"+std::to_string(i),{"line "+std::to_string(i)});
+    }
+
+    auto before=sorted(CodeRepo(dir).list());
+
+    CodeRepo sharded(dir,true);
+    CHECK(sharded.list() == before);
+    CHECK(fs::exists(dir/"MANIFEST"));
+    CHECK(!fs::exists(dir/"p0.txt"));
+    CHECK(sharded.makePath("p0") != dir/"p0.txt");
+    CHECK(sharded.read("p7") == "line 7\n");
+
+    // the layout is remembered, a caller that doesn't ask for it gets it too
+    CodeRepo reopened(dir);
+    CHECK(reopened.list() == before);
+    CHECK(reopened.makePath("p0") == sharded.makePath("p0"));
+}
+
+static void testJournal()
+{
+    auto dir=scratch("journal");
+
+    CodeRepo first(dir,true);
+    CodeRepo second(dir,true);
+
+    first.add("x",{"x"});
+    second.add("y",{"y"});
+    first.add("z",{"z"});
+    second.remove("z");
+
+    // every change is appended, neither process overwrote the other
+    CHECK(fs::exists(dir/"MANIFEST.log"));
+    CHECK(CodeRepo(dir).list() == std::vector<std::string>({"x","y"}));
+
+    // a line cut by a crash is skipped, and the next change still lands on a line of its own
+    {
+        std::ofstream fout(dir/"MANIFEST.log",std::ios::binary|std::ios::app);
+        fout << "+cut";
+    }
+    CHECK(CodeRepo(dir).list() == std::vector<std::string>({"x","y"}));
+
+    first.add("w",{"w"});
+    CHECK(CodeRepo(dir).list() == std::vector<std::string>({"w","x","y"}));
+}
+
+static void testCompaction()
+{
+    auto dir=scratch("compaction");
+
+    CodeRepo repo(dir,true);
+    CodeRepo other(dir,true);
+    other.add("other",{"o"});
+
+    std::vector<std::string> expected{"other"};
+    for(int i=0;i<1000;i++)
+    {
+        auto pid="pid"+std::to_string(i);
+        repo.add(pid,{pid});
+        expected.push_back(pid);
+    }
+
+    // the journal was folded into the manifest along the way, the other process's change too
+    CHECK(fs::file_size(dir/"MANIFEST")>0);
+    CHECK(fs::file_size(dir/"MANIFEST.log")<1000*7);
+    CHECK(CodeRepo(dir).list() == sorted(expected));
+}
+
+static void testWarmUp()
+{
+    auto dir=scratch("warmup");
+
+    CodeRepo repo(dir,true);
+    for(int i=0;i<300;i++)
+        repo.add("w"+std::to_string(i),{"int x"+std::to_string(i)+";","\treturn 0;"});
+
+    int last=0;
+    bool ordered=true;
+    CHECK(repo.warmUp([&](int done,int total)
+    {
+        ordered=ordered && done>last && total == 300;
+        last=done;
+    },4) == 0);
+
+    CHECK(ordered);
+    CHECK(last == 300);
+
+    // the preprocessed text is the same as a cold load's
+    auto warm=repo.loadSnippet("w7");
+    auto cold=CodeSnippet(CodeSnippet::preprocess(repo.read("w7")));
+    CHECK(warm.getMasked() == cold.getMasked());
+}
+
+static std::vector<std::string> body(int i)
+{
+    auto n="n"+std::to_string(i);
+    return {"#include <iostream>","int main()","{","    int "+n+";","    std::cin >> "+n+";","    return 0;","}"};
+}
+
+static std::string joined(const std::vector<std::string>& lines)
+{
+    std::string text;
+    for(auto& line:lines)
+        text += line+'\n';
+
+    return text;
+}
+
+static void testCompressed()
+{
+    auto dir=scratch("compressed");
+
+    {
+        CodeRepo flat(dir);
+        for(int i=0;i<30;i++)
+            flat.add("c"+std::to_string(i),body(i));
+    }
+
+    // the plain snippets are converted, and the layout is remembered
+    CodeRepo repo(dir,false,true);
+    CHECK(repo.list().size() == 30);
+    CHECK(fs::exists(dir/"DICTIONARY"));
+    CHECK(!fs::exists(dir/"c0.txt"));
+    CHECK(fs::exists(dir/"c0.lz"));
+    CHECK(fs::file_size(dir/"c0.lz")<joined(body(0)).size());
+
+    CodeRepo reopened(dir);
+    for(int i=0;i<30;i++)
+        CHECK(reopened.read("c"+std::to_string(i)) == joined(body(i)));
+
+    reopened.add("new",body(99));
+    CHECK(CodeRepo(dir).read("new") == joined(body(99)));
+
+    // a snippet still written with the old dictionary reads after a retraining
+    auto old=dir/"old.lz";
+    fs::copy_file(dir/"c1.lz",old);
+    reopened.trainDictionary();
+    fs::rename(old,dir/"c1.lz");
+
+    CodeRepo retrained(dir);
+    for(int i=0;i<30;i++)
+        CHECK(retrained.read("c"+std::to_string(i)) == joined(body(i)));
+}
+
+static void testInterruptedMigration()
+{
+    auto dir=scratch("migration");
+
+    {
+        CodeRepo flat(dir);
+        for(int i=0;i<10;i++)
+            flat.add("m"+std::to_string(i),body(i));
+    }
+    CodeRepo(dir,false,true);
+
+    // as if the run stopped before DICTIONARY was written, with a plain file left over
+    fs::remove(dir/"DICTIONARY");
+    fs::remove(dir/"m3.lz");
+    {
+        std::ofstream fout(dir/"m3.txt");
+        fout << joined(body(3));
+    }
+
+    CodeRepo repo(dir);
+    CHECK(fs::exists(dir/"DICTIONARY"));
+    CHECK(!fs::exists(dir/"m3.txt"));
+    CHECK(repo.list().size() == 10);
+    for(int i=0;i<10;i++)
+        CHECK(repo.read("m"+std::to_string(i)) == joined(body(i)));
+}
+
+static void testPids()
+{
+    auto dir=scratch("pids");
+
+    CodeRepo repo(dir);
+
+    auto rejected=[&repo](const std::string& pid)
+    {
+        try
+        {
+            repo.add(pid,{"x"});
+        }
+        catch(const AppException&)
+        {
+            return true;
+        }
+
+        return false;
+    };
+
+    CHECK(rejected(""));
+    CHECK(rejected(std::string(33,'a')));
+    CHECK(rejected("a/b"));
+    CHECK(rejected("a b"));
+    CHECK(rejected(".."));
+    CHECK(!rejected(std::string(32,'a')));
+    CHECK(!rejected("P1001_a-b"));
+
+    // a file the records couldn't tell apart from another one is left out
+    {
+        std::ofstream fout(dir/(std::string(40,'b')+".txt"));
+        fout << "x\n";
+    }
+    CHECK(CodeRepo(dir).list() == std::vector<std::string>({"P1001_a-b",std::string(32,'a')}));
+}
+
+int main()
+{
+    testFlat();
+    testConvert();
+    testJournal();
+    testCompaction();
+    testWarmUp();
+    testCompressed();
+    testInterruptedMigration();
+    testPids();
+
+    return report("repo_test");
+}
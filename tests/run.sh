@@ -0,0 +1,20 @@
+#!/bin/sh
+# builds and runs the tests: sh tests/run.sh [name_test ...], all of them by default
+cd "$(dirname "$0")" || exit 1
+mkdir -p build
+
+if [ $# -eq 0 ]; then
+    set -- $(ls *_test.cpp | sed 's/\.cpp$//')
+fi
+
+status=0
+for name in "$@"; do
+    if ! g++ -std=c++17 -O2 -Wall -pthread "$name.cpp" -o "build/$name"; then
+        status=1
+        continue
+    fi
+
+    "./build/$name" || status=1
+done
+
+exit $status
@@ -0,0 +1,401 @@
+#include "check.h"
+
+#ifdef __linux__
+#include <csignal>
+
+// a blocking client of the line protocol
+class Client
+{
+private:
+    int fd=-1;
+    std::string input;
+
+public:
+    Client(int port)
+    {
+        fd=socket(AF_INET,SOCK_STREAM|SOCK_CLOEXEC,0);
+
+        sockaddr_in addr{};
+        addr.sin_family=AF_INET;
+        addr.sin_port=htons((std::uint16_t)port);
+        inet_pton(AF_INET,"127.0.0.1",&addr.sin_addr);
+
+        if(connect(fd,(sockaddr*)&addr,sizeof(addr)) != 0)
+            throw AppException("Cannot connect");
+    }
+
+    Client(const fs::path& socketPath)
+    {
+        fd=socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+
+        sockaddr_un addr{};
+        addr.sun_family=AF_UNIX;
+        std::strcpy(addr.sun_path,socketPath.c_str());
+
+        if(connect(fd,(sockaddr*)&addr,sizeof(addr)) != 0)
+            throw AppException("Cannot connect");
+    }
+
+    ~Client()
+    {
+        if(fd >= 0)
+            ::close(fd);
+    }
+
+    void send(const std::string& text)
+    {
+        ::send(fd,text.data(),text.size(),MSG_NOSIGNAL);
+    }
+
+    // one line, empty once the server closed the connection
+    std::string line()
+    {
+        while(true)
+        {
+            auto end=input.find('\n');
+            if(end != std::string::npos)
+            {
+                std::string result=input.substr(0,end);
+                input.erase(0,end+1);
+                return result;
+            }
+
+            char buffer[4096];
+            ssize_t n=recv(fd,buffer,sizeof(buffer),0);
+            if(n <= 0)
+                return {};
+            input.append(buffer,n);
+        }
+    }
+
+    // the status line, then its lines
+    std::string reply(std::vector<std::string>* lines=nullptr)
+    {
+        std::string status=line();
+
+        auto space=status.find(' ');
+        if(status.compare(0,3,"ERR") != 0 && space != std::string::npos)
+        {
+            int count=std::stoi(status.substr(space+1));
+            for(int i=0;i<count;i++)
+            {
+                std::string text=line();
+                if(lines)
+                    lines -> push_back(text);
+            }
+        }
+
+        return status;
+    }
+
+    std::string request(const std::string& text,std::vector<std::string>* lines=nullptr)
+    {
+        send(text+"\n");
+        return reply(lines);
+    }
+};
+
+// a server on its own thread, stopped by SIGTERM like the real one
+class TestServer
+{
+private:
+    GameServer server;
+    std::thread thread;
+
+public:
+    TestServer(const fs::path& root,const std::string& address):server(root,address)
+    {
+        thread=std::thread([this]{server.run();});
+    }
+
+    ~TestServer()
+    {
+        kill(getpid(),SIGTERM);
+        thread.join();
+
+        // the signal is still pending, the next server must not see it
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask,SIGTERM);
+        timespec none{};
+        sigtimedwait(&mask,nullptr,&none);
+    }
+
+    int port()
+    {
+        return server.port();
+    }
+};
+
+static fs::path makeRoot(const std::string& name)
+{
+    auto root=scratch(name);
+
+    CodeRepo repo(root/"CodeSnippets");
+    repo.add("P1",{"int main"});
+
+    return root;
+}
+
+static void testProtocol()
+{
+    auto root=makeRoot("server_protocol");
+
+    {
+        TestServer server(root,"0");
+        CHECK(server.port()>0);
+
+        Client client(server.port());
+
+        CHECK(client.request("USER ../x").compare(0,4,"ERR ") == 0);
+        CHECK(client.request("USER alice") == "OK 0");
+        CHECK(client.request("GUESS int") == "ERR No game is running");
+        CHECK(client.request("START X") == "ERR Unknown mode: X");
+        CHECK(client.request("HELLO") == "ERR Unknown command: HELLO");
+
+        std::vector<std::string> lines;
+        CHECK(client.request("START G",&lines).compare(0,3,"OK ") == 0);
+        CHECK(!lines.empty());
+        CHECK(client.request("START P") == "ERR A game is running");
+        CHECK(client.request("USER bob") == "ERR A game is running");
+
+        CHECK(client.request("GUESS int").compare(0,3,"OK ") == 0);
+        CHECK(client.request("SHOW").compare(0,3,"OK ") == 0);
+        CHECK(client.request("AUTO").compare(0,5,"OK 1") == 0);
+
+        // the last word wins the game
+        lines.clear();
+        CHECK(client.request("GUESS main",&lines).compare(0,4,"END ") == 0);
+        CHECK(client.request("SHOW") == "ERR No game is running");
+
+        // then one that is given up
+        CHECK(client.request("START P").compare(0,3,"OK ") == 0);
+        CHECK(client.request("END").compare(0,4,"END ") == 0);
+
+        // the replies of pipelined requests come in order, then the connection closes
+        client.send("START T\nEND\nQUIT\nSTATS\n");
+        CHECK(client.reply().compare(0,3,"OK ") == 0);
+        CHECK(client.reply().compare(0,4,"END ") == 0);
+        CHECK(client.reply() == "OK 0");
+        CHECK(client.line().empty());
+    }
+
+    // the server saved the games of alice
+    StatisticsStore store(root/"Profiles");
+    auto alice=store.get("alice");
+    CHECK(alice -> historySize() == 3);
+    CHECK(alice -> getStatistics()[1] == "Guess Limited Games: 1/1");
+    CHECK(!store.exists("guest"));
+}
+
+static void testDisconnect()
+{
+    auto root=makeRoot("server_disconnect");
+
+    {
+        TestServer server(root,"0");
+
+        {
+            Client client(server.port());
+            CHECK(client.request("USER carol") == "OK 0");
+            CHECK(client.request("START G").compare(0,3,"OK ") == 0);
+        }
+
+        // a line that never ends is cut off
+        Client client(server.port());
+        client.send(std::string(10000,'x'));
+        CHECK(client.line() == "ERR Line too long");
+        CHECK(client.line().empty());
+    }
+
+    // leaving in the middle of a game loses it
+    StatisticsStore store(root/"Profiles");
+    auto carol=store.get("carol");
+    CHECK(carol -> historySize() == 1);
+    CHECK(carol -> getHistory(0,1)[0].result == 0);
+}
+
+static void testConcurrentClients()
+{
+    auto root=makeRoot("server_concurrent");
+
+    constexpr int CLIENTS=8;
+    constexpr int GAMES=10;
+
+    {
+        TestServer server(root,"0");
+
+        // each client plays its games at once with the others, on the workers of the pool
+        std::atomic<int> wrong{0};
+        std::vector<std::thread> clients;
+        for(int c=0;c<CLIENTS;c++)
+            clients.emplace_back([&,c]
+            {
+                Client client(server.port());
+                if(client.request("USER u"+std::to_string(c)) != "OK 0")
+                    wrong++;
+
+                for(int g=0;g<GAMES;g++)
+                {
+                    // pipelined, the replies still come in order
+                    client.send("START G\nGUESS int\nSHOW\nEND\n");
+                    for(const char* status:{"OK ","OK ","OK ","END "})
+                        if(client.reply().compare(0,std::strlen(status),status) != 0)
+                            wrong++;
+                }
+            });
+
+        for(auto& client:clients)
+            client.join();
+
+        CHECK(wrong == 0);
+    }
+
+    StatisticsStore store(root/"Profiles");
+    for(int c=0;c<CLIENTS;c++)
+        CHECK(store.get("u"+std::to_string(c)) -> historySize() == GAMES);
+}
+
+static void testResume()
+{
+    auto root=makeRoot("server_resume");
+    auto snapshot=[&](const std::string& user){return fs::exists(StatisticsStore(root/"Profiles").userPath(user).replace_filename("Game.snap"));};
+
+    // the server stops in the middle of the games, the clients are still there
+    {
+        auto server=std::make_unique<TestServer>(root,"0");
+
+        Client dave(server -> port());
+        CHECK(dave.request("USER dave") == "OK 0");
+        CHECK(dave.request("START G").compare(0,3,"OK ") == 0);
+        CHECK(dave.request("GUESS int").compare(0,3,"OK ") == 0);
+
+        Client guest(server -> port());
+        CHECK(guest.request("START G").compare(0,3,"OK ") == 0);
+
+        server.reset();
+    }
+
+    CHECK(snapshot("dave"));
+    CHECK(!snapshot("guest"));
+
+    {
+        TestServer server(root,"0");
+
+        Client guest(server.port());
+        CHECK(guest.request("RESUME") == "ERR Guests have no saved games");
+
+        // the first one to resume takes the game, the second finds none
+        Client first(server.port());
+        Client second(server.port());
+        CHECK(first.request("USER dave") == "OK 0");
+        CHECK(second.request("USER dave") == "OK 0");
+
+        std::vector<std::string> lines;
+        CHECK(first.request("RESUME",&lines).compare(0,3,"OK ") == 0);
+        CHECK(lines.size() >= 3 && lines[1] == "Guesses: 1/30");
+        CHECK(second.request("RESUME") == "ERR No saved game");
+        CHECK(!snapshot("dave"));
+
+        CHECK(first.request("RESUME") == "ERR A game is running");
+        CHECK(first.request("GUESS main").compare(0,4,"END ") == 0);
+        CHECK(first.request("RESUME") == "ERR No saved game");
+    }
+
+    CHECK(!snapshot("dave"));
+
+    // the resumed game was saved once, as a win
+    StatisticsStore store(root/"Profiles");
+    auto dave=store.get("dave");
+    CHECK(dave -> historySize() == 1);
+    CHECK(dave -> getHistory(0,1)[0].result == 1);
+}
+
+static void testDaily()
+{
+    auto root=makeRoot("server_daily");
+
+    TestServer server(root,"0");
+
+    Client erin(server.port());
+    Client frank(server.port());
+    CHECK(erin.request("USER erin") == "OK 0");
+    CHECK(frank.request("USER frank") == "OK 0");
+
+    CHECK(erin.request("START D 5") == "ERR The daily challenge has its own seed");
+
+    // the same seed for everyone, and the ID is not shown
+    std::vector<std::string> first,second;
+    CHECK(erin.request("START D",&first).compare(0,3,"OK ") == 0);
+    CHECK(frank.request("START D",&second).compare(0,3,"OK ") == 0);
+    CHECK(!first.empty() && first == second);
+    CHECK(first[2].compare(0,8,"Problem:") != 0);
+
+    std::vector<std::string> lines;
+    CHECK(erin.request("GUESS P",&lines) == "OK 1");
+    CHECK(lines[0] == "The problem ID stays hidden in the daily challenge");
+
+    CHECK(erin.request("GUESS int").compare(0,3,"OK ") == 0);
+    CHECK(erin.request("GUESS main").compare(0,4,"END ") == 0);
+    CHECK(frank.request("END").compare(0,4,"END ") == 0);
+
+    // only the win is on the board of the day, once the writer saved it
+    auto mentions=[&](const char* user)
+    {
+        return std::count_if(lines.begin(),lines.end(),[&](const std::string& line){return line.find(user) != std::string::npos;});
+    };
+    for(int i=0;i<100 && mentions("erin") == 0;i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        lines.clear();
+        CHECK(erin.request("DAILY",&lines).compare(0,3,"OK ") == 0);
+    }
+    CHECK(mentions("erin") == 1 && mentions("frank") == 0);
+}
+
+static void testUnixSocket()
+{
+    auto root=makeRoot("server_unix");
+    auto socketPath=root/"cordle.sock";
+
+    {
+        TestServer server(root,"unix:"+socketPath.string());
+        CHECK(server.port() == -1);
+        CHECK(fs::is_socket(socketPath));
+
+        Client client(socketPath);
+        CHECK(client.request("QUIT") == "OK 0");
+    }
+
+    CHECK(!fs::exists(socketPath));
+
+    bool thrown=false;
+    try
+    {
+        GameServer server(root,"1.2.3:99999");
+    }
+    catch(const AppException&)
+    {
+        thrown=true;
+    }
+    CHECK(thrown);
+}
+
+int main()
+{
+    testProtocol();
+    testDisconnect();
+    testConcurrentClients();
+    testResume();
+    testDaily();
+    testUnixSocket();
+
+    return report("server_test");
+}
+#else
+int main()
+{
+    return report("server_test");
+}
+#endif
@@ -0,0 +1,90 @@
+// operator delete below frees with free(), which is what the replaced operator new allocated with
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+#include "check.h"
+
+// the allocations of each thread, to see that a warmed-up game allocates nothing;
+// the statistics writer allocates on its own thread whenever it wakes up
+static thread_local long allocations=0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if(void* p=std::malloc(size ?size:1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p,std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static void testIds()
+{
+    auto root=scratch("session_ids");
+    CodeRepo repo(root/"CodeSnippets");
+    repo.add("P1",{"int main"});
+    StatisticsRepo stats(root/"Statistics.dat");
+
+    SessionManager manager;
+    auto first=manager.create<guessLimitedGame>(repo,stats,true,false);
+    auto second=manager.create<pointGame>(repo,stats,false,false);
+    CHECK(first != 0 && second != 0 && first != second);
+    CHECK(manager.size() == 2);
+
+    CHECK(manager.get(first) && manager.get(first) -> start());
+    CHECK(manager.get(first) -> currentId() == "P1");
+
+    // a released ID never finds the game that reuses its slot
+    CHECK(manager.release(first));
+    CHECK(!manager.release(first));
+    CHECK(!manager.get(first));
+
+    auto third=manager.create<timeAttackGame>(repo,stats,true,false);
+    CHECK((std::uint32_t)third == (std::uint32_t)first && third != first);
+    CHECK(!manager.get(first) && manager.get(third));
+    CHECK(manager.size() == 2);
+
+    CHECK(!manager.get(0) && !manager.get(((SessionManager::Id)1<<32)|1000));
+}
+
+static void testNoAllocations()
+{
+    auto root=scratch("session_allocations");
+    CodeRepo repo(root/"CodeSnippets");
+    repo.add("P1",{"int main() { return 0; }","// a second line"});
+    repo.add("P2",{"int x;"});
+    StatisticsRepo stats(root/"Statistics.dat");
+
+    SessionManager manager;
+    auto cycle=[&]
+    {
+        auto id=manager.create<guessLimitedGame>(repo,stats,true,false);
+        manager.get(id) -> start();
+        manager.release(id);
+    };
+
+    // the texts are cached and the pool holds its blocks after a few games
+    for(int i=0;i<20;i++)
+        cycle();
+
+    long before=allocations;
+    for(int i=0;i<100;i++)
+        cycle();
+    CHECK(allocations == before);
+}
+
+int main()
+{
+    testIds();
+    testNoAllocations();
+
+    return report("session_test");
+}
@@ -0,0 +1,120 @@
+#include "check.h"
+
+struct Fixture
+{
+    fs::path root;
+    CodeRepo repo;
+    StatisticsRepo stats;
+    SessionManager games;
+
+    Fixture(const std::string& name):root(scratch(name)),repo(root/"CodeSnippets"),stats(root/"Statistics.dat")
+    {
+        repo.add("P1",{"int main() { return value * 2 + other; }","// some words to guess: alpha beta gamma"});
+    }
+};
+
+static const std::vector<std::string> GUESSES={"int","zzz","main","yyy","xxx","www","return","vvv","uuu","ttt","alpha"};
+
+// a game saved in the middle goes on exactly like the one that was not saved
+template<class Mode>
+static void testRoundTrip(Fixture& f,bool fuzzy)
+{
+    auto original=f.games.create<Mode>(f.repo,f.stats,fuzzy,true);
+    Game& game=*f.games.get(original);
+    game.setSeed(77);
+    game.record(true);
+    CHECK(game.start());
+
+    for(int i=0;i<5;i++)
+        game.makeGuess(GUESSES[i]);
+
+    std::string data;
+    game.snapshot(data);
+
+    auto restored=f.games.restore(f.repo,f.stats,data);
+    Game& copy=*f.games.get(restored);
+
+    CHECK(copy.currentId() == game.currentId());
+    CHECK(copy.getSeed() == 77);
+    CHECK(copy.guessCount() == 5);
+    CHECK(copy.getMasked() == game.getMasked());
+    CHECK(copy.getGameInfo() == game.getGameInfo());
+    CHECK(copy.replayLog() == game.replayLog());
+
+    // the generators went on from where they were, so the reveals and hints match too
+    bool same=true;
+    for(std::size_t i=5;i<GUESSES.size() && !game.isFinished();i++)
+        same=same && copy.makeGuess(GUESSES[i]) == game.makeGuess(GUESSES[i]) && copy.getMasked() == game.getMasked();
+    CHECK(same);
+    CHECK(copy.random().next() == game.random().next());
+
+    // saving the copy gives the same bytes, apart from the clock
+    std::string again;
+    copy.snapshot(again);
+    std::string last;
+    game.snapshot(last);
+    CHECK(again.size() == last.size());
+
+    f.games.release(original);
+    f.games.release(restored);
+}
+
+static void testModes()
+{
+    Fixture f("snapshot_modes");
+
+    testRoundTrip<guessLimitedGame>(f,true);
+    testRoundTrip<timeAttackGame>(f,true);
+    testRoundTrip<pointGame>(f,false);
+    CHECK(f.games.size() == 0);
+}
+
+static bool throws(const std::function<void()>& work)
+{
+    try
+    {
+        work();
+    }
+    catch(const AppException&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+static void testRefused()
+{
+    Fixture f("snapshot_refused");
+
+    Game game(std::in_place_type<guessLimitedGame>,f.repo,f.stats,true,true);
+    CHECK(game.start());
+    game.makeGuess("int");
+
+    std::string data;
+    game.snapshot(data);
+
+    // cut off, with bytes left over, of another mode or not a snapshot at all
+    CHECK(throws([&]{f.games.restore(f.repo,f.stats,data.substr(0,data.size()-1));}));
+    CHECK(throws([&]{f.games.restore(f.repo,f.stats,data+"x");}));
+    CHECK(throws([&]{f.games.restore(f.repo,f.stats,"hello");}));
+
+    Game point(std::in_place_type<pointGame>,f.repo,f.stats,false,false);
+    CHECK(throws([&]{point.restore(data);}));
+
+    // the failed restores keep no slot
+    CHECK(f.games.size() == 0);
+
+    // the state means nothing once the code behind the pid changed
+    f.repo.add("P1",{"int main() { return 1; }"});
+    CHECK(throws([&]{f.games.restore(f.repo,f.stats,data);}));
+    CHECK(f.games.size() == 0);
+}
+
+int main()
+{
+    testModes();
+    testRefused();
+
+    return report("snapshot_test");
+}
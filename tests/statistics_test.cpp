@@ -0,0 +1,357 @@
+#include "check.h"
+
+static GameRecord makeRecord(GameMode mode,bool win,double points,const std::string& pid)
+{
+    GameRecord record;
+    record.time=1700000000;
+    record.mode=mode;
+    record.result=win ?1:0;
+    record.points=points;
+    record.guesses=5;
+    record.setPid(pid);
+
+    return record;
+}
+
+static void testQueue()
+{
+    MpscQueue<int,8> queue;
+
+    int value=0;
+    CHECK(!queue.tryPop(value));
+
+    for(int i=0;i<8;i++)
+        CHECK(queue.tryPush(i));
+    CHECK(!queue.tryPush(8));
+
+    for(int i=0;i<8;i++)
+    {
+        CHECK(queue.tryPop(value));
+        CHECK(value == i);
+    }
+    CHECK(!queue.tryPop(value));
+
+    // the cells are reused once the consumer has passed them
+    CHECK(queue.tryPush(42));
+    CHECK(queue.tryPop(value) && value == 42);
+}
+
+static void testQueueProducers()
+{
+    constexpr int PRODUCERS=4;
+    constexpr int COUNT=200000;
+
+    MpscQueue<std::pair<int,int>,1024> queue;
+
+    std::vector<std::thread> producers;
+    for(int p=0;p<PRODUCERS;p++)
+        producers.emplace_back([&queue,p]
+        {
+            for(int i=0;i<COUNT;i++)
+                while(!queue.tryPush({p,i}))
+                    std::this_thread::yield();
+        });
+
+    // every value arrives once, and each producer's values in the order pushed
+    std::vector<int> next(PRODUCERS,0);
+    bool ordered=true;
+    int received=0;
+    while(received<PRODUCERS*COUNT)
+    {
+        std::pair<int,int> item;
+        if(!queue.tryPop(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ordered=ordered && item.second == next[item.first];
+        next[item.first]=item.second+1;
+        received++;
+    }
+
+    for(auto& producer:producers)
+        producer.join();
+
+    CHECK(ordered);
+    for(int p=0;p<PRODUCERS;p++)
+        CHECK(next[p] == COUNT);
+
+    std::pair<int,int> item;
+    CHECK(!queue.tryPop(item));
+}
+
+static void testWriter()
+{
+    auto dir=scratch("writer");
+    auto path=dir/"Statistics.dat";
+
+    {
+        StatisticsRepo stats(path);
+
+        std::vector<std::thread> players;
+        for(int t=0;t<4;t++)
+            players.emplace_back([&stats,t]
+            {
+                for(int i=0;i<500;i++)
+                    stats.addGame(makeRecord(GameMode::Point,false,2,"p"+std::to_string(t)));
+            });
+
+        for(auto& player:players)
+            player.join();
+
+        stats.flush();
+        CHECK(stats.historySize() == 2000);
+        CHECK(stats.getStatistics()[0] == "Total Games: 2000");
+
+        // queued only, the destructor saves it
+        stats.addGame(makeRecord(GameMode::GuessLimited,true,0,std::string(32,'z')));
+    }
+
+    StatisticsRepo reopened(path);
+    CHECK(reopened.historySize() == 2001);
+    CHECK(reopened.getStatistics()[1] == "Guess Limited Games: 1/1");
+
+    auto newest=reopened.getHistory(0,2);
+    CHECK(newest.size() == 2);
+    CHECK(newest[0].getPid() == std::string(32,'z'));
+
+    // the formatted line carries the whole ID
+    CHECK(GameHistoryFormatter::format(newest[0]).find(std::string(32,'z')) != std::string::npos);
+}
+
+static void testSnippetTable()
+{
+    auto dir=scratch("snippets");
+
+    SnippetStatsTable table;
+    table.open(dir/"table");
+
+    // far over the first capacity, so the table grows several times
+    for(int round=0;round<3;round++)
+        for(int i=0;i<5000;i++)
+        {
+            auto record=makeRecord(GameMode::GuessLimited,i%2 == 0,0,"s"+std::to_string(i));
+            record.guesses=10+round;
+            table.add(record);
+        }
+
+    CHECK(table.appliedRecords() == 15000);
+
+    SnippetAggregate a{};
+    CHECK(table.find("s4",a));
+    CHECK(a.plays == 3 && a.wins == 3);
+    CHECK(std::abs(a.guesses.mean-11)<1e-9);
+    CHECK(std::abs(a.guesses.variance(a.plays)-1)<1e-9);
+    CHECK(!table.find("missing",a));
+
+    SnippetStatsTable reopened;
+    reopened.open(dir/"table");
+    CHECK(reopened.appliedRecords() == 15000);
+    CHECK(reopened.find("s4999",a) && a.plays == 3 && a.wins == 0);
+
+    // a table cut short is not trusted
+    table.sync();
+    fs::resize_file(dir/"table",100);
+    SnippetStatsTable damaged;
+    damaged.open(dir/"table");
+    CHECK(damaged.appliedRecords() == 0);
+    CHECK(!damaged.find("s4",a));
+}
+
+static void testSnippetCatchUp()
+{
+    auto dir=scratch("catchup");
+    auto path=dir/"Statistics.dat";
+
+    {
+        StatisticsRepo stats(path);
+        for(int i=0;i<100;i++)
+            stats.addGame(makeRecord(GameMode::Point,false,i,i%2 ?"odd":"even"));
+    }
+
+    // a lost table is rebuilt from the history
+    fs::remove(path.string()+".snippets");
+
+    StatisticsRepo stats(path);
+    SnippetAggregate a{};
+    CHECK(stats.getSnippetStats("odd",a));
+    CHECK(a.plays == 50);
+    CHECK(std::abs(a.points.mean-50)<1e-9);
+    CHECK(stats.getSnippetSummary("nothing") == "Never played");
+}
+
+static void testSketch()
+{
+    QuantileSketch sketch{};
+    for(int i=0;i<1000;i++)
+        sketch.add(i);
+
+    // buckets are at most 12.5% wide
+    for(double q:{0.1,0.5,0.9,0.99})
+        CHECK(std::abs(sketch.quantile(q)-q*999) <= q*999*0.125+1);
+    CHECK(sketch.quantile(0) == 0);
+    CHECK(sketch.quantile(1) == 999);
+
+    // small fractional values are not truncated to whole numbers
+    QuantileSketch small{};
+    for(int i=0;i<100;i++)
+        small.add(i<50 ?0.5:1.75);
+    CHECK(small.quantile(0.25) == 0.5);
+    CHECK(small.quantile(0.75) == 1.75);
+
+    // negative values are monotonic and mirror the positive side
+    QuantileSketch both{};
+    for(int i=-1000;i <= 1000;i++)
+        both.add(i);
+    double last=-2000;
+    for(int i=0;i <= 100;i++)
+    {
+        double value=both.quantile(i/100.0);
+        CHECK(value >= last);
+        last=value;
+    }
+    CHECK(std::abs(both.quantile(0.1)+both.quantile(0.9))<1e-9);
+
+    // merging is the same as adding everything to one sketch
+    QuantileSketch left{},right{},all{};
+    for(int i=0;i<500;i++)
+    {
+        left.add(i*3.5);
+        right.add(i*0.25);
+        all.add(i*3.5);
+        all.add(i*0.25);
+    }
+    left.merge(right);
+    CHECK(left.count() == 1000);
+    for(double q:{0.1,0.5,0.9})
+        CHECK(left.quantile(q) == all.quantile(q));
+}
+
+static void testSketchStore()
+{
+    auto dir=scratch("sketches");
+    auto path=dir/"Statistics.dat";
+
+    {
+        StatisticsRepo stats(path);
+        for(int i=0;i<300;i++)
+        {
+            auto record=makeRecord(GameMode::Point,false,i,"p"+std::to_string(i%100));
+            record.guesses=1+i%6;
+            stats.addGame(record);
+        }
+    }
+
+    // a lost store is rebuilt from the history, and grows past its first 64 blocks
+    fs::remove(path.string()+".sketches");
+
+    StatisticsRepo stats(path);
+    SketchStore::Block block{};
+    CHECK(stats.getSketches((std::uint32_t)GameMode::Point,block));
+    CHECK(block.metric[SketchStore::POINTS].count() == 300);
+    CHECK(block.metric[SketchStore::POINTS].quantile(1) == 299);
+    CHECK(block.metric[SketchStore::GUESSES].quantile(0) == 1);
+
+    SnippetAggregate a{};
+    CHECK(stats.getSnippetStats("p99",a));
+    CHECK(a.sketchBlock >= SketchStore::MODE_BLOCKS);
+    CHECK(stats.getSketches(a.sketchBlock,block));
+    CHECK(block.metric[SketchStore::POINTS].count() == 3);
+    CHECK(block.metric[SketchStore::POINTS].quantile(0) == 99);
+    CHECK(block.metric[SketchStore::POINTS].quantile(1) == 299);
+    CHECK(!stats.getSketches(1000,block));
+}
+
+static void testHistoryIndex()
+{
+    HistoryIndex index;
+    for(int i=0;i<1000;i++)
+    {
+        auto record=makeRecord((GameMode)(i%3),i%4 == 0,i,"p"+std::to_string(i%10));
+        record.time=1000+i;
+        index.add(record);
+    }
+
+    // mode, result and pid together, the newest first
+    HistoryQuery q;
+    q.mode=(int)GameMode::Point;
+    q.result=1;
+    q.pid="p2";
+    auto ids=index.find(q,1000);
+    CHECK(!ids.empty());
+    for(std::size_t i=0;i<ids.size();i++)
+    {
+        CHECK(ids[i]%3 == 2 && ids[i]%4 == 0 && ids[i]%10 == 2);
+        if(i>0)
+            CHECK(ids[i]<ids[i-1]);
+    }
+    CHECK(ids.size() == 17); // i%60 == 32, below 1000
+
+    // a time range, continued from a cursor
+    HistoryQuery range;
+    range.from=1100;
+    range.to=1199;
+    auto first=index.find(range,60);
+    CHECK(first.size() == 60 && first.front() == 199 && first.back() == 140);
+    range.before=first.back();
+    auto rest=index.find(range,60);
+    CHECK(rest.size() == 40 && rest.front() == 139 && rest.back() == 100);
+
+    // an unknown pid matches nothing
+    HistoryQuery unknown;
+    unknown.pid="nothing";
+    CHECK(index.find(unknown,10).empty());
+
+    // the clock went backwards, the prefix maximum keeps the lower end exact
+    HistoryIndex skewed;
+    for(std::int64_t t:{10,30,20,40})
+    {
+        auto record=makeRecord(GameMode::Point,true,0,"p");
+        record.time=t;
+        skewed.add(record);
+    }
+    HistoryQuery late;
+    late.from=25;
+    CHECK(skewed.find(late,10) == std::vector<std::int64_t>({3,1}));
+}
+
+static void testQuery()
+{
+    auto dir=scratch("query");
+    StatisticsRepo stats(dir/"Statistics.dat");
+    for(int i=0;i<50;i++)
+        stats.addGame(makeRecord(GameMode::GuessLimited,i%2 == 0,0,"q"+std::to_string(i%5)));
+    stats.flush();
+
+    HistoryQuery q;
+    q.pid="q3";
+    auto page=stats.query(q,6);
+    CHECK(page.size() == 6);
+    for(auto& record:page)
+        CHECK(record.getPid() == "q3");
+
+    // the index follows the later saves
+    stats.addGame(makeRecord(GameMode::GuessLimited,true,0,"q3"));
+    stats.flush();
+
+    HistoryQuery again;
+    again.pid="q3";
+    CHECK(stats.query(again,100).size() == 11);
+    CHECK(stats.queryLines(q,100).size() == 4);
+}
+
+int main()
+{
+    testQueue();
+    testQueueProducers();
+    testWriter();
+    testSnippetTable();
+    testSnippetCatchUp();
+    testSketch();
+    testSketchStore();
+    testHistoryIndex();
+    testQuery();
+
+    return report("statistics_test");
+}
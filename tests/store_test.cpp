@@ -0,0 +1,111 @@
+#include "check.h"
+
+static GameRecord makeRecord(bool win,const std::string& pid)
+{
+    GameRecord record;
+    record.time=1700000000;
+    record.mode=GameMode::GuessLimited;
+    record.result=win ?1:0;
+    record.guesses=5;
+    record.setPid(pid);
+
+    return record;
+}
+
+static void testUserPaths()
+{
+    auto dir=scratch("store_paths");
+    StatisticsStore store(dir);
+
+    // two hashed levels, then the user's own directory
+    auto path=store.userPath("alice");
+    CHECK(path.filename() == "Statistics.dat");
+    CHECK(path.parent_path().filename() == "alice");
+    CHECK(path.parent_path().parent_path().parent_path().parent_path() == dir);
+    CHECK(store.userPath("alice") == path);
+
+    bool thrown=false;
+    try
+    {
+        store.get("../etc");
+    }
+    catch(const AppException&)
+    {
+        thrown=true;
+    }
+    CHECK(thrown);
+    CHECK(store.activeUsers() == 0);
+}
+
+static void testEviction()
+{
+    auto dir=scratch("store_eviction");
+
+    {
+        StatisticsStore store(dir,2);
+
+        auto alice=store.get("alice");
+        alice -> addGame(makeRecord(true,"P1"));
+
+        store.get("bob") -> addGame(makeRecord(false,"P2"));
+        CHECK(store.activeUsers() == 2);
+
+        // carol evicts alice, the least recently used; alice's repo stays valid for its holder
+        store.get("carol");
+        CHECK(store.activeUsers() == 2);
+
+        alice -> addGame(makeRecord(false,"P1"));
+        alice -> flush();
+        CHECK(alice -> historySize() == 2);
+
+        // a hit moves bob to the front, so dave evicts carol
+        store.get("bob");
+        store.get("dave");
+        CHECK(store.get("bob") -> historySize() == 1);
+
+        // alice is loaded again from her file
+        auto again=store.get("alice");
+        CHECK(again != alice);
+        CHECK(again -> historySize() == 2);
+        CHECK(store.exists("alice") && !store.exists("nobody"));
+    }
+
+    // the games survive the store
+    StatisticsStore store(dir);
+    CHECK(store.get("alice") -> historySize() == 2);
+    CHECK(store.get("bob") -> getStatistics()[1] == "Guess Limited Games: 0/1");
+}
+
+static void testConcurrentUsers()
+{
+    auto dir=scratch("store_concurrent");
+    StatisticsStore store(dir,4);
+
+    // the same users from several threads, with evictions in between
+    std::vector<std::thread> threads;
+    for(int t=0;t<4;t++)
+        threads.emplace_back([&,t]
+        {
+            for(int i=0;i<200;i++)
+                store.get("user"+std::to_string((i+t)%8)) -> addGame(makeRecord(true,"P"+std::to_string(t)));
+        });
+
+    for(auto& thread:threads)
+        thread.join();
+
+    store.flush();
+
+    std::int64_t games=0;
+    for(int u=0;u<8;u++)
+        games += store.get("user"+std::to_string(u)) -> historySize();
+    CHECK(games == 800);
+}
+
+int main()
+{
+    testUserPaths();
+    testEviction();
+    testConcurrentUsers();
+
+    return report("store_test");
+}
@@ -0,0 +1,194 @@
+#include "check.h"
+
+static GameRecord makeRecord(GameMode mode,bool win,double value,const std::string& pid,std::int64_t time=1700000000)
+{
+    GameRecord record;
+    record.time=time;
+    record.mode=mode;
+    record.result=win ?1:0;
+    record.setPid(pid);
+
+    if(mode == GameMode::Point)
+        record.points=value;
+    if(mode == GameMode::GuessLimited)
+        record.guesses=(std::int32_t)value;
+    if(mode == GameMode::TimeAttack)
+        record.seconds=(std::int32_t)value;
+
+    return record;
+}
+
+static void testGrowth()
+{
+    auto dir=scratch("tables_growth");
+
+    // far past the first 1024 slots, every key is found again after each doubling
+    {
+        SnippetStatsTable table;
+        table.open(dir/"snippets");
+        for(int round=0;round<3;round++)
+            for(int i=0;i<5000;i++)
+                table.add(makeRecord(GameMode::Point,false,i,"k"+std::to_string(i)));
+    }
+
+    SnippetStatsTable table;
+    table.open(dir/"snippets");
+    CHECK(table.appliedRecords() == 15000);
+
+    int found=0;
+    for(int i=0;i<5000;i++)
+    {
+        SnippetAggregate a{};
+        if(table.find("k"+std::to_string(i),a) && a.plays == 3 && a.points.mean == i)
+            found++;
+    }
+    CHECK(found == 5000);
+
+    SnippetAggregate a{};
+    CHECK(!table.find("k5000",a));
+}
+
+static void testHeaderChecks()
+{
+    auto dir=scratch("tables_header");
+
+    {
+        LeaderboardTable table;
+        table.open(dir/"leaders");
+        table.add(makeRecord(GameMode::Point,false,10,"P1"));
+    }
+
+    // another table kind in the file is not taken for this one
+    {
+        SnippetStatsTable other;
+        other.open(dir/"leaders");
+        CHECK(other.appliedRecords() == 0);
+    }
+
+    // the boards of another K are rebuilt
+    {
+        LeaderboardTable table;
+        table.open(dir/"leaders");
+        table.add(makeRecord(GameMode::Point,false,10,"P1"));
+        table.sync();
+    }
+    {
+        std::fstream f(dir/"leaders",std::ios::in|std::ios::out|std::ios::binary);
+        f.seekp(20);
+        std::uint32_t k=5;
+        f.write((const char*)&k,4);
+    }
+
+    LeaderboardTable table;
+    table.open(dir/"leaders");
+    CHECK(table.appliedRecords() == 0);
+    CHECK(table.top(LeaderboardTable::POINTS).empty());
+}
+
+static void testLeaderboards()
+{
+    auto dir=scratch("tables_leaders");
+    LeaderboardTable table;
+    table.open(dir/"leaders");
+
+    // more games than fit, in a shuffled order
+    std::vector<int> values;
+    for(int i=0;i<50;i++)
+        values.push_back((i*37)%50);
+
+    for(int v:values)
+    {
+        table.add(makeRecord(GameMode::Point,false,v,"P"+std::to_string(v%2)),"u"+std::to_string(v));
+        table.add(makeRecord(GameMode::GuessLimited,true,v+1,"P1"));
+        table.add(makeRecord(GameMode::GuessLimited,false,0,"P1")); // a lost game is no record
+    }
+
+    auto best=table.top(LeaderboardTable::POINTS);
+    CHECK((int)best.size() == LeaderboardTable::K);
+    for(int i=0;i<(int)best.size();i++)
+        CHECK(best[i].value == 49-i);
+    CHECK(best[0].getUser() == "u49" && best[0].getPid() == "P1");
+
+    auto even=table.top(LeaderboardTable::POINTS,"P0");
+    CHECK(even.size() == 10 && even[0].value == 48 && even[9].value == 30);
+
+    auto guesses=table.top(LeaderboardTable::GUESSES,"P1");
+    CHECK(guesses.size() == 10 && guesses[0].value == 1 && guesses[9].value == 10);
+
+    // the earlier game keeps its place on a tie
+    table.add(makeRecord(GameMode::TimeAttack,true,30,"T",200));
+    table.add(makeRecord(GameMode::TimeAttack,true,30,"T",100));
+    auto fastest=table.top(LeaderboardTable::SECONDS,"T");
+    CHECK(fastest.size() == 2 && fastest[0].time == 100);
+
+    CHECK(table.top(LeaderboardTable::SECONDS,"nothing").empty());
+
+    auto lines=LeaderboardFormatter::formatAll([&](int metric){return table.top(metric,"T");});
+    CHECK(lines.size() == 3 && lines[0] == "Fastest Time Attack:");
+    CHECK(lines[1].rfind(" 1. 30s  T  ",0) == 0);
+}
+
+static void testRollup()
+{
+    auto dir=scratch("tables_rollup");
+    auto path=dir/"Statistics.dat";
+
+    const std::uint64_t total=9*SharedHistory::SEGMENT_RECORDS+10;
+    {
+        SharedHistory history;
+        history.open(path);
+
+        // the best game is in the part that gets compacted
+        history.append(makeRecord(GameMode::Point,false,1000000,"best"));
+        for(std::uint64_t i=1;i<total;i++)
+            history.append(makeRecord(GameMode::Point,false,(double)(i%1000),"p"));
+    }
+
+    {
+        StatisticsRepo stats(path);
+        CHECK(stats.historySize() == (std::int64_t)(total-SharedHistory::SEGMENT_RECORDS));
+        CHECK(stats.getLeaderboard(LeaderboardTable::POINTS)[0].value == 1000000);
+    }
+
+    // lost boards come back from the rollup, with the games that were compacted
+    fs::remove(path.string()+".leaders");
+
+    StatisticsRepo stats(path);
+    auto best=stats.getLeaderboard(LeaderboardTable::POINTS);
+    CHECK(!best.empty() && best[0].value == 1000000 && best[0].getPid() == "best");
+    CHECK(stats.getLeaderboard(LeaderboardTable::POINTS,"best").size() == 1);
+}
+
+static void testGlobalBoards()
+{
+    auto dir=scratch("tables_global");
+
+    {
+        StatisticsStore store(dir);
+        store.get("alice") -> addGame(makeRecord(GameMode::Point,false,500,"P1"));
+        store.get("bob") -> addGame(makeRecord(GameMode::Point,false,700,"P1"));
+        store.get("bob") -> addGame(makeRecord(GameMode::GuessLimited,true,3,"P2"));
+        store.flush();
+
+        auto best=store.getLeaderboard(LeaderboardTable::POINTS,"P1");
+        CHECK(best.size() == 2);
+        CHECK(best[0].getUser() == "bob" && best[1].getUser() == "alice");
+
+        // a user's own boards only have their games
+        CHECK(store.get("alice") -> getLeaderboard(LeaderboardTable::POINTS).size() == 1);
+    }
+
+    StatisticsStore store(dir);
+    CHECK(store.getLeaderboard(LeaderboardTable::GUESSES)[0].getUser() == "bob");
+}
+
+int main()
+{
+    testGrowth();
+    testHeaderChecks();
+    testLeaderboards();
+    testRollup();
+    testGlobalBoards();
+
+    return report("tables_test");
+}
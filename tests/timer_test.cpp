@@ -0,0 +1,109 @@
+#include "check.h"
+
+// runs the wheel like the server loop does: sleep as long as it says, then advance
+template<class Fire>
+static std::uint64_t runUntilEmpty(TimerWheel& wheel,std::uint64_t now,Fire&& fire)
+{
+    for(int rounds=0;!wheel.empty() && rounds<1000000;rounds++)
+    {
+        now += std::max<std::int64_t>(wheel.msUntilNext(now),1);
+        wheel.advance(now,[&](std::uint64_t payload){fire(now,payload);});
+    }
+
+    return now;
+}
+
+static void testFiring()
+{
+    TimerWheel wheel;
+    CHECK(wheel.empty() && wheel.msUntilNext(0) == -1);
+
+    // delays on every level of the wheel
+    const std::vector<std::uint64_t> delays={0,1,9,10,15,630,640,641,5000,40950,41000,2621430,3000000};
+    const std::uint64_t start=123456;
+
+    for(std::size_t i=0;i<delays.size();i++)
+        wheel.schedule(start,delays[i],i);
+    CHECK(wheel.size() == delays.size());
+
+    std::vector<std::uint64_t> fired(delays.size(),0);
+    runUntilEmpty(wheel,start,[&](std::uint64_t now,std::uint64_t payload){fired[payload]=now;});
+
+    // never early, and at most two ticks late
+    for(std::size_t i=0;i<delays.size();i++)
+    {
+        CHECK(fired[i] >= start+delays[i]);
+        CHECK(fired[i] <= start+delays[i]+2*TimerWheel::TICK_MS);
+    }
+
+    // past the last level a timer fires at the end of the wheel, it is not lost
+    wheel.schedule(start,1000ull*3600*1000,0);
+
+    bool late=false;
+    runUntilEmpty(wheel,start,[&](std::uint64_t now,std::uint64_t){late=now>start+1000ull*3600*40;});
+    CHECK(late);
+}
+
+static void testCancel()
+{
+    TimerWheel wheel;
+
+    std::vector<TimerWheel::Id> ids;
+    for(int i=0;i<100;i++)
+        ids.push_back(wheel.schedule(0,(std::uint64_t)i*1000,i));
+
+    // every other one is cancelled, a second cancel does nothing
+    for(int i=0;i<100;i += 2)
+        CHECK(wheel.cancel(ids[i]));
+    CHECK(!wheel.cancel(ids[0]));
+    CHECK(!wheel.cancel(0));
+    CHECK(wheel.size() == 50);
+
+    std::vector<int> fired;
+    runUntilEmpty(wheel,0,[&](std::uint64_t,std::uint64_t payload){fired.push_back((int)payload);});
+
+    CHECK(fired.size() == 50);
+    for(std::size_t i=0;i<fired.size();i++)
+        CHECK(fired[i] == 2*(int)i+1);
+
+    // a fired timer's ID does not match the timer that reuses its node
+    auto id=wheel.schedule(0,10,7);
+    CHECK(!wheel.cancel(ids[1]));
+    CHECK(wheel.cancel(id));
+}
+
+static void testRescheduling()
+{
+    TimerWheel wheel;
+
+    // a repeating timer schedules itself again when it fires, like the reveals of a game
+    int ticks=0;
+    std::uint64_t last=0;
+    wheel.schedule(0,10000,1);
+    runUntilEmpty(wheel,0,[&](std::uint64_t now,std::uint64_t)
+    {
+        last=now;
+        if(++ticks<6)
+            wheel.schedule(now,10000,1);
+    });
+
+    CHECK(ticks == 6);
+    CHECK(last >= 60000 && last <= 60000+6*2*TimerWheel::TICK_MS);
+
+    // an idle wheel skips ahead instead of walking the ticks in between
+    wheel.schedule(1000000000,50,2);
+    CHECK(wheel.msUntilNext(1000000000) <= 70);
+
+    bool fired=false;
+    runUntilEmpty(wheel,1000000000,[&](std::uint64_t,std::uint64_t){fired=true;});
+    CHECK(fired);
+}
+
+int main()
+{
+    testFiring();
+    testCancel();
+    testRescheduling();
+
+    return report("timer_test");
+}